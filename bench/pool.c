@@ -0,0 +1,75 @@
+/* Throughput of the interpreter pool (see pool.c) on a batch of independent
+ * scripts, for 1, 2, 4, ... worker threads, up to the number of CPUs.
+ * The results go to stderr, since the prelude's output goes to stdout.
+ *
+ * Usage: pool_bench std.tl [jobs [max-threads]]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../tinylisp.h"
+
+static const char *job_text =
+	"(define fib (lambda (n) (if (< n 2) n (+ (fib (- n 1)) (fib (- n 2))))))\n"
+	"(fib 15)\n";
+
+static size_t bad;
+
+static void check(tl_interp *in, tl_object *result, void *arg) {
+	if(tl_has_error(in) || !tl_is_int(result) || result->ival != 610) __atomic_add_fetch(&bad, 1, __ATOMIC_RELAXED);
+}
+
+static char *slurp(const char *fn) {
+	FILE *f = fopen(fn, "r");
+	char *buf;
+	long sz;
+	if(!f) return NULL;
+	fseek(f, 0, SEEK_END);
+	sz = ftell(f);
+	rewind(f);
+	buf = malloc(sz + 1);
+	buf[fread(buf, 1, sz, f)] = 0;
+	fclose(f);
+	return buf;
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char **argv) {
+	char *prelude;
+	size_t jobs = argc > 2 ? strtoul(argv[2], NULL, 10) : 256, i, n;
+	size_t ncpu = argc > 3 ? strtoul(argv[3], NULL, 10) : (size_t)sysconf(_SC_NPROCESSORS_ONLN);
+	double base = 0;
+
+	if(argc < 2 || !(prelude = slurp(argv[1]))) {
+		fprintf(stderr, "usage: %s std.tl [jobs [max-threads]]\n", argv[0]);
+		return 1;
+	}
+	for(n = 1; n <= ncpu; n *= 2) {
+		double start, rate;
+		tl_pool *pool = tl_pool_create(n, prelude);
+		if(!pool) {
+			fprintf(stderr, "pool: prelude failed\n");
+			return 1;
+		}
+		start = now();
+		for(i = 0; i < jobs; i++) tl_pool_submit(pool, job_text, check, NULL);
+		tl_pool_wait(pool);
+		rate = jobs / (now() - start);
+		if(n == 1) base = rate;
+		fprintf(stderr, "pool %zu threads: %.0f jobs/s (%.2fx)\n", n, rate, rate / base);
+		tl_pool_destroy(pool);
+	}
+	free(prelude);
+	if(bad) {
+		fprintf(stderr, "pool: %zu jobs gave the wrong result\n", bad);
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,158 @@
+/* Throughput of tl_read on a large s-expression data file, reading it a
+ * character at a time through tl_interp::readf, in chunks through
+ * tl_interp::readbuf , and straight out of memory through
+ * tl_interp::input_buf ; with the pool, also split among threads by
+ * tl_read_parallel .
+ * Without a FILE, 50 MB of generated records are read instead. (Symbols and
+ * strings are interned, so they're drawn from a small set.)
+ *
+ * Usage: read_bench [FILE]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../tinylisp.h"
+
+#define GENERATED_SIZE (50 << 20)
+#define CHUNK_SIZE 65536
+/* How much tl_read_parallel reads at once, so the forms fit in memory */
+#define SLICE_SIZE (4 << 20)
+
+enum { BY_CHAR, BY_CHUNK, BY_BUFFER };
+
+struct bench_state {
+	const char *data;
+	size_t len, pos, forms;
+	int done;
+};
+
+static char *slurp(const char *fn, size_t *len) {
+	FILE *f = fopen(fn, "r");
+	char *buf;
+	long sz;
+	if(!f) return NULL;
+	fseek(f, 0, SEEK_END);
+	sz = ftell(f);
+	rewind(f);
+	buf = malloc(sz + 1);
+	*len = fread(buf, 1, sz, f);
+	fclose(f);
+	return buf;
+}
+
+static char *generate(size_t *len) {
+	char *buf = malloc(GENERATED_SIZE + 256);
+	size_t n = 0, i = 0;
+	while(n < GENERATED_SIZE) {
+		n += sprintf(buf + n,
+			"(record %zu \"name %zu\" (tags alpha beta-%zu gamma) (point %zu %zu) (1 2 3 4 5 6 7 8) (nested (deeper (deepest %zu))))\n",
+			i, i % 1000, i % 97, i * 7, i * 13, i);
+		i++;
+	}
+	*len = n;
+	return buf;
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int readf(tl_interp *in) {
+	struct bench_state *st = in->udata;
+	return st->pos < st->len ? (unsigned char)st->data[st->pos++] : EOF;
+}
+
+static int readbuf(tl_interp *in, const char **data, size_t *len) {
+	struct bench_state *st = in->udata;
+	if(st->pos >= st->len) return 0;
+	*data = st->data + st->pos;
+	*len = st->len - st->pos < CHUNK_SIZE ? st->len - st->pos : CHUNK_SIZE;
+	st->pos += *len;
+	return 1;
+}
+
+static void read_k(tl_interp *in, tl_object *args, tl_object *_) {
+	struct bench_state *st = in->udata;
+	if(!tl_first(args)) {
+		st->done = 1;
+	} else {
+		st->forms++;
+	}
+	tl_cfunc_return(in, in->true_);
+}
+
+static void run(const char *label, const char *data, size_t len, int how) {
+	tl_interp in;
+	struct bench_state st = { data, len, 0, 0, 0 };
+	double start, secs;
+
+	tl_interp_init(&in);
+	in.udata = &st;
+	in.readf = readf;
+	if(how == BY_CHUNK) in.readbuf = readbuf;
+	if(how == BY_BUFFER) {
+		in.input_buf = data;
+		in.input_len = len;
+		st.pos = len;
+	}
+	start = now();
+	while(!st.done) {
+		tl_read_and_then(&in, read_k, TL_EMPTY_LIST);
+		tl_run_until_done(&in);
+		tl_interp_reset(&in);
+		tl_gc(&in);
+	}
+	secs = now() - start;
+	fprintf(stderr, "read %s: %zu forms in %.3fs, %.1f MB/s\n", label, st.forms, secs, len / secs / (1 << 20));
+	tl_interp_cleanup(&in);
+}
+
+#ifdef CONFIG_POOL
+static void run_parallel(const char *data, size_t len) {
+	tl_interp in;
+	long nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t pos = 0, slice, used, forms = 0;
+	double start, secs;
+
+	if(nthreads < 1) nthreads = 1;
+	tl_interp_init(&in);
+	start = now();
+	while(pos < len) {
+		slice = len - pos < SLICE_SIZE ? len - pos : SLICE_SIZE;
+		/* The end of a slice is the end of input, so don't cut a line in two */
+		while(pos + slice < len && slice > 1 && data[pos + slice - 1] != '\n') slice--;
+		tl_object *list = tl_read_parallel(&in, data + pos, slice, nthreads, &used);
+		forms += tl_list_len(list);
+		if(!used) break;
+		pos += used;
+		tl_gc(&in);
+	}
+	secs = now() - start;
+	fprintf(stderr, "read parallel (%ld threads): %zu forms in %.3fs, %.1f MB/s\n", nthreads, forms, secs, pos / secs / (1 << 20));
+	tl_interp_cleanup(&in);
+}
+#endif
+
+int main(int argc, char **argv) {
+	size_t len;
+	char *data = argc > 1 ? slurp(argv[1], &len) : generate(&len);
+
+	if(!data) {
+		fprintf(stderr, "usage: %s [FILE]\n", argv[0]);
+		return 1;
+	}
+	fprintf(stderr, "read: %zu bytes\n", len);
+	run("readf", data, len, BY_CHAR);
+	run("readbuf", data, len, BY_CHUNK);
+	run("input_buf", data, len, BY_BUFFER);
+#ifdef CONFIG_POOL
+	run_parallel(data, len);
+#endif
+	free(data);
+	return 0;
+}
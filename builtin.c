@@ -54,6 +54,12 @@ TL_CF(macro, "macro") {
 	tl_cfunc_return(in, tl_new_macro(in, fargs, envn, body, in->env));
 }
 
+TL_CF(macro_pure, "macro-pure") {
+	tl_object *fargs = tl_first(args);
+	tl_object *body = tl_next(args);
+	tl_cfunc_return(in, tl_new_macro_pure(in, fargs, body, in->env));
+}
+
 TL_CF(lambda, "lambda") {
 	tl_object *fargs = tl_first(args);
 	tl_object *body = tl_next(args);
@@ -120,6 +126,29 @@ TL_CFBV(display_indent, "display-indent") {
 	tl_cfunc_return(in, in->true_);
 }
 
+/* With no arguments, returns (labels max-depth max-length); otherwise sets
+ * those given, in that order. See tl_print_opts. */
+TL_CFBV_N(print_opts, "print-opts", 0, 3) {
+	tl_print_opts *opts = &in->print_opts;
+	size_t i;
+	if(!argc) {
+		tl_cfunc_return(in, tl_new_pair(in, _boolify(opts->labels),
+			tl_new_pair(in, tl_new_int(in, opts->max_depth),
+			tl_new_pair(in, tl_new_int(in, opts->max_length), TL_EMPTY_LIST))
+		));
+	}
+	for(i = 1; i < argc; i++) {
+		if(!tl_is_int(argv[i]) || argv[i]->ival < 0) {
+			tl_error_set(in, tl_new_pair(in, tl_new_sym(in, "tl-print-opts with non-natural limit"), argv[i]));
+			tl_cfunc_return(in, in->false_);
+		}
+	}
+	opts->labels = _unboolify(in, argv[0]);
+	if(argc > 1) opts->max_depth = argv[1]->ival;
+	if(argc > 2) opts->max_length = argv[2]->ival;
+	tl_cfunc_return(in, in->true_);
+}
+
 TL_CF(prefix, "prefix") {
 	tl_object *prefix = tl_first(args);
 	tl_object *name = tl_first(tl_next(args));
@@ -140,6 +169,12 @@ TL_CFBV(evalin, "eval-in&") {
 	 */
 }
 
+TL_CFBV_N(eval_in, "eval-in", 2, 2) {
+	/* The value is left on the stack by tl_push_eval, either now or once the
+	 * pushed application completes--a normal return, with no TL_CONT needed. */
+	tl_push_eval(in, argv[1], argv[0]);
+}
+
 TL_CFBV(call_with_current_continuation, "call-with-current-continuation") {
 	arity_1(in, args, "call-with-current-continuation");
 	tl_object *cont = tl_new_cont(in, in->env, in->conts, in->values);
@@ -147,24 +182,159 @@ TL_CFBV(call_with_current_continuation, "call-with-current-continuation") {
 	tl_values_push(in, cont);
 }
 
-TL_CFBV(cons, "cons") {
-	arity_n(in, args, 2, "cons");
-	tl_cfunc_return(in, tl_new_pair(in, tl_first(args), tl_first(tl_next(args))));
+TL_CFBV(call_ec, "call/ec") {
+	arity_1(in, args, "call/ec");
+	tl_object *ec = tl_new_ec(in);
+	tl_push_apply(in, TL_APPLY_EXIT_EC, ec->state, TL_EMPTY_LIST);
+	tl_push_apply(in, 1, tl_first(args), in->env);
+	tl_values_push(in, ec);
+}
+
+TL_CFBV(spawn, "spawn") {
+	arity_1(in, args, "spawn");
+	verify_type(in, tl_first(args), callable, "spawn");
+	tl_cfunc_return(in, tl_spawn(in, tl_first(args)));
+}
+
+TL_CFBV(yield, "yield") {
+	tl_values_push(in, in->true_);
+	tl_yield(in);
+}
+
+TL_CFBV(join, "join") {
+	arity_1(in, args, "join");
+	verify_type(in, tl_first(args), task, "join");
+	tl_push_apply(in, 0, tl_first(args), in->env);
+}
+
+TL_CFBV(chan, "chan") {
+	tl_cfunc_return(in, tl_new_chan(in));
+}
+
+TL_CFBV(send, "send") {
+	arity_n(in, args, 2, "send");
+	verify_type(in, tl_first(args), chan, "send");
+	tl_push_apply(in, 1, tl_first(args), in->env);
+	tl_values_push(in, tl_first(tl_next(args)));
+}
+
+TL_CFBV(recv, "recv") {
+	arity_1(in, args, "recv");
+	verify_type(in, tl_first(args), chan, "recv");
+	tl_push_apply(in, 0, tl_first(args), in->env);
+}
+
+/** Push a prompt (see ::TL_APPLY_PROMPT) delimiting the current stacks. */
+#define _tl_push_prompt(in) tl_push_apply((in), TL_APPLY_PROMPT, tl_new_pair((in), (in)->values, (in)->rescue), TL_EMPTY_LIST)
+
+TL_CFBV(reset, "reset") {
+	arity_1(in, args, "reset");
+	_tl_push_prompt(in);
+	tl_push_apply(in, 0, tl_first(args), in->env);
+}
+
+/** Count the entries of the stack `from` above its tail `to`, or -1 if it isn't one. */
+static long _tl_stack_depth(tl_object *from, tl_object *to) {
+	long depth = 0;
+	for(; from != to; from = tl_next(from), depth++) {
+		if(!from) return -1;
+	}
+	return depth;
+}
+
+/** Skip the top `n` entries of a stack. */
+static tl_object *_tl_stack_drop(tl_object *stack, long n) {
+	while(n-- > 0) stack = tl_next(stack);
+	return stack;
+}
+
+/** C function behind a delimited continuation (see `tl-shift`).
+ *
+ * `state` is `(conts values . rescues)`: the captured slices of the
+ * continuation and value stacks, each reversed (bottom first), and for each
+ * `tl-rescue` handler in the slice (also bottom first), `(conts-depth
+ * values-depth . env)`, where its escape continuation stood in them. Invoking
+ * it reinstates them on top of the current stacks, under a new prompt, with a
+ * fresh handler for each one, so the value of the captured computation is
+ * returned to the caller; it can be invoked any number of times.
+ */
+static void _tl_shift_k(tl_interp *in, tl_object *args, tl_object *state) {
+	tl_object *conts = tl_first(state), *values = tl_first(tl_next(state));
+	long nconts = tl_list_len(conts), nvalues = tl_list_len(values);
+	_tl_push_prompt(in);
+	for(tl_list_iter(conts, cont)) {
+		in->conts = tl_new_pair(in, cont, in->conts);
+	}
+	for(tl_list_iter(values, val)) {
+		in->values = tl_new_pair(in, val, in->values);
+	}
+	for(tl_list_iter(tl_next(tl_next(state)), where)) {
+		tl_object *ec = tl_new_ec(in);
+		ec->state->first = _tl_stack_drop(in->conts, nconts - tl_first(where)->ival);
+		tl_next(ec->state)->first = _tl_stack_drop(in->values, nvalues - tl_first(tl_next(where))->ival);
+		tl_next(tl_next(ec->state))->first = tl_next(tl_next(where));
+		tl_rescue_push(in, ec);
+	}
+	tl_cfunc_return(in, args ? tl_first(args) : in->false_);
+}
+
+TL_CFBV(shift, "shift") {
+	tl_object *prompt = in->conts, *record, *conts = TL_EMPTY_LIST, *values = TL_EMPTY_LIST, *rescues = TL_EMPTY_LIST, *k;
+	arity_1(in, args, "shift");
+	for(; prompt; prompt = tl_next(prompt)) {
+		if(tl_first(tl_first(prompt))->ival == TL_APPLY_PROMPT) break;
+		conts = tl_new_pair(in, tl_first(prompt), conts);
+	}
+	if(!prompt) {
+		tl_error_set(in, tl_new_sym(in, "shift without reset"));
+		tl_cfunc_return(in, in->false_);
+	}
+	record = tl_first(tl_next(tl_first(prompt)));
+	for(tl_object *val = in->values; val != tl_first(record); val = tl_next(val)) {
+		if(!val) {
+			tl_error_set(in, tl_new_sym(in, "shift past its prompt's values"));
+			tl_cfunc_return(in, in->false_);
+		}
+		values = tl_new_pair(in, tl_first(val), values);
+	}
+	for(tl_object *r = in->rescue; r != tl_next(record); r = tl_next(r)) {
+		tl_object *ec = r ? tl_first(r) : NULL;
+		long cdepth = -1, vdepth = -1;
+		if(ec && tl_is_cfunc_byval(ec) && ec->state && tl_next(ec->state)) {
+			cdepth = _tl_stack_depth(tl_first(ec->state), prompt);
+			vdepth = _tl_stack_depth(tl_first(tl_next(ec->state)), tl_first(record));
+		}
+		if(cdepth < 0 || vdepth < 0) {
+			tl_error_set(in, tl_new_sym(in, "shift past its prompt's rescues"));
+			tl_cfunc_return(in, in->false_);
+		}
+		rescues = tl_new_pair(in, tl_new_pair(in, tl_new_int(in, cdepth),
+				tl_new_pair(in, tl_new_int(in, vdepth), tl_first(tl_next(tl_next(ec->state))))), rescues);
+	}
+	k = _tl_new_cfunc_byval(in, _tl_shift_k, "tl-shift-k");
+	k->state = tl_new_pair(in, conts, tl_new_pair(in, values, rescues));
+	/* Abort to the prompt, which stays in place around the call; the handlers
+	 * of any tl-rescue in between are dropped (and their escapes invalidated) */
+	tl_unwind(in, prompt, tl_next(record));
+	in->values = tl_first(record);
+	tl_push_apply(in, 1, tl_first(args), in->env);
+	tl_values_push(in, k);
+}
+
+TL_CFBV_N(cons, "cons", 2, 2) {
+	tl_cfunc_return(in, tl_new_pair(in, argv[0], argv[1]));
 }
 
-TL_CFBV(car, "car") {
-	arity_1(in, args, "car");
-	tl_cfunc_return(in, tl_first(tl_first(args)));
+TL_CFBV_N(car, "car", 1, 1) {
+	tl_cfunc_return(in, tl_first(argv[0]));
 }
 
-TL_CFBV(cdr, "cdr") {
-	arity_1(in, args, "cdr");
-	tl_cfunc_return(in, tl_next(tl_first(args)));
+TL_CFBV_N(cdr, "cdr", 1, 1) {
+	tl_cfunc_return(in, tl_next(argv[0]));
 }
 
-TL_CFBV(null, "null?") {
-	arity_1(in, args, "null?");
-	tl_cfunc_return(in,  _boolify(!tl_first(args)));
+TL_CFBV_N(null, "null?", 1, 1) {
+	tl_cfunc_return(in,  _boolify(!argv[0]));
 }
 
 static void _tl_cf_if_k(tl_interp *in, tl_object *result, tl_object *branches) {
@@ -194,6 +364,361 @@ TL_CF(set, "set!") {
 	tl_eval_and_then(in, val, key, _tl_cf_set_k);
 }
 
+/** Push a body of expressions to be evaluated in `env`, as a user function does.
+ *
+ * The last expression is in tail position; its value is the value of the
+ * body. An empty body evaluates to false.
+ */
+static void _tl_push_body(tl_interp *in, tl_object *body, tl_object *env) {
+	if(!body) tl_cfunc_return(in, in->false_);
+	tl_object *body_rvs = tl_list_rvs(in, body);
+	for(tl_list_iter(body_rvs, ex)) {
+		tl_push_apply(in, ex == tl_first(body_rvs) ? TL_APPLY_PUSH_EVAL : TL_APPLY_DROP_EVAL, ex, env);
+	}
+}
+
+TL_CF(begin, "begin") {
+	_tl_push_body(in, args, tl_new_pair(in, TL_EMPTY_LIST, in->env));
+}
+
+static void _tl_cf_let_k(tl_interp *in, tl_object *vals, tl_object *args) {
+	tl_object *frm = TL_EMPTY_LIST;
+	for(tl_list_iter(tl_first(args), binding)) {
+		frm = tl_new_pair(in, tl_new_pair(in, tl_first(binding), tl_first(vals)), frm);
+		vals = tl_next(vals);
+	}
+	_tl_push_body(in, tl_next(args), tl_new_pair(in, frm, in->env));
+}
+
+TL_CF(let, "let") {
+	tl_object *inits = TL_EMPTY_LIST;
+	arity_1(in, args, "let");
+	for(tl_list_iter(tl_first(args), binding)) {
+		if(!tl_is_pair(binding) || !tl_is_sym(tl_first(binding))) {
+			tl_error_set(in, tl_new_pair(in, tl_new_sym(in, "bad let binding"), binding));
+			tl_cfunc_return(in, in->false_);
+		}
+		inits = tl_new_pair(in, tl_new_pair(in, tl_first(tl_next(binding)), in->true_), inits);
+	}
+	tl_eval_all_args(in, tl_list_rvs(in, inits), args, _tl_cf_let_k);
+}
+
+static void _tl_cf_letstar_k(tl_interp *, tl_object *, tl_object *);
+
+/* state is (bindings . body), with the bindings yet to be made */
+static void _tl_letstar_next(tl_interp *in, tl_object *state) {
+	tl_object *binding = tl_first(tl_first(state));
+	if(!tl_first(state)) {
+		_tl_push_body(in, tl_next(state), in->env);
+		return;
+	}
+	if(!tl_is_pair(binding) || !tl_is_sym(tl_first(binding))) {
+		tl_error_set(in, tl_new_pair(in, tl_new_sym(in, "bad let* binding"), binding));
+		tl_cfunc_return(in, in->false_);
+	}
+	tl_eval_and_then(in, tl_first(tl_next(binding)), state, _tl_cf_letstar_k);
+}
+
+static void _tl_cf_letstar_k(tl_interp *in, tl_object *result, tl_object *state) {
+	tl_object *binding = tl_first(tl_first(state));
+	/* Each binding gets its own frame, so later inits can shadow earlier ones */
+	in->env = tl_new_pair(in, tl_new_pair(in, tl_new_pair(in, tl_first(binding), tl_first(result)), TL_EMPTY_LIST), in->env);
+	_tl_letstar_next(in, tl_new_pair(in, tl_next(tl_first(state)), tl_next(state)));
+}
+
+TL_CF(letstar, "let*") {
+	arity_1(in, args, "let*");
+	if(!tl_first(args)) in->env = tl_new_pair(in, TL_EMPTY_LIST, in->env);
+	_tl_letstar_next(in, args);
+}
+
+static void _tl_cf_cond_k(tl_interp *, tl_object *, tl_object *);
+
+static void _tl_cond_next(tl_interp *in, tl_object *clauses) {
+	if(!clauses) tl_cfunc_return(in, in->false_);
+	if(!tl_is_pair(tl_first(clauses))) {
+		tl_error_set(in, tl_new_pair(in, tl_new_sym(in, "bad cond clause"), tl_first(clauses)));
+		tl_cfunc_return(in, in->false_);
+	}
+	tl_eval_and_then(in, tl_first(tl_first(clauses)), clauses, _tl_cf_cond_k);
+}
+
+static void _tl_cf_cond_k(tl_interp *in, tl_object *result, tl_object *clauses) {
+	tl_object *body = tl_next(tl_first(clauses));
+	if(!_unboolify(in, tl_first(result))) {
+		_tl_cond_next(in, tl_next(clauses));
+		return;
+	}
+	if(!body) tl_cfunc_return(in, tl_first(result));
+	_tl_push_body(in, body, tl_new_pair(in, TL_EMPTY_LIST, in->env));
+}
+
+TL_CF(cond, "cond") {
+	_tl_cond_next(in, args);
+}
+
+static void _tl_cf_and_k(tl_interp *in, tl_object *result, tl_object *rest) {
+	if(!_unboolify(in, tl_first(result))) tl_cfunc_return(in, in->false_);
+	if(!rest) tl_cfunc_return(in, in->true_);
+	tl_eval_and_then(in, tl_first(rest), tl_next(rest), _tl_cf_and_k);
+}
+
+TL_CF(and, "and") {
+	if(!args) tl_cfunc_return(in, in->true_);
+	tl_eval_and_then(in, tl_first(args), tl_next(args), _tl_cf_and_k);
+}
+
+static void _tl_cf_or_k(tl_interp *in, tl_object *result, tl_object *rest) {
+	if(_unboolify(in, tl_first(result))) tl_cfunc_return(in, in->true_);
+	if(!rest) tl_cfunc_return(in, in->false_);
+	tl_eval_and_then(in, tl_first(rest), tl_next(rest), _tl_cf_or_k);
+}
+
+TL_CF(or, "or") {
+	if(!args) tl_cfunc_return(in, in->false_);
+	tl_eval_and_then(in, tl_first(args), tl_next(args), _tl_cf_or_k);
+}
+
+/* A loop's frame binds this name to its record, `(conts values rescue vars . body)`:
+ * the continuation, value, and rescue stacks to which a break or recur unwinds,
+ * the bindings of the loop variables (rebound in place by recur), and the body,
+ * reversed, to push for each iteration. */
+#define TL_LOOP_RECORD "#tl-loop"
+#define _tl_loop_conts(record) tl_first(record)
+#define _tl_loop_values(record) tl_first(tl_next(record))
+#define _tl_loop_rescue(record) tl_first(tl_next(tl_next(record)))
+#define _tl_loop_vars(record) tl_first(tl_next(tl_next(tl_next(record))))
+#define _tl_loop_body_rvs(record) tl_next(tl_next(tl_next(tl_next(record))))
+
+/** Push a loop body (from its record) for evaluation in `env`. */
+static void _tl_loop_body(tl_interp *in, tl_object *record, tl_object *env) {
+	tl_object *body_rvs = _tl_loop_body_rvs(record);
+	if(!body_rvs) tl_cfunc_return(in, in->false_);
+	for(tl_list_iter(body_rvs, ex)) {
+		tl_push_apply(in, ex == tl_first(body_rvs) ? TL_APPLY_PUSH_EVAL : TL_APPLY_DROP_EVAL, ex, env);
+	}
+}
+
+/** The name of the loop record, resolved once per interpreter (see tl_interp::loop_name). */
+static tl_name *_tl_loop_name(tl_interp *in) {
+	if(!in->loop_name) {
+		in->loop_name = tl_ns_resolve(in, &in->ns, (tl_buffer) {TL_LOOP_RECORD, sizeof(TL_LOOP_RECORD) - 1});
+	}
+	return in->loop_name;
+}
+
+/** Find the record of the innermost loop lexically enclosing tl_interp::env.
+ *
+ * On success, `*loop_env` is set to the environment of the loop body (whose
+ * first frame has the record, among the loop variables and any definitions
+ * made in the body). Returns NULL outside of any loop.
+ */
+static tl_object *_tl_loop_find(tl_interp *in, tl_object **loop_env) {
+	tl_name *nm = _tl_loop_name(in);
+	for(tl_object *env = in->env; env; env = tl_next(env)) {
+		for(tl_list_iter(tl_first(env), kv)) {
+			if(kv && tl_is_sym(tl_first(kv)) && tl_first(kv)->nm == nm) {
+				*loop_env = env;
+				return tl_next(kv);
+			}
+		}
+	}
+	return NULL;
+}
+
+/** Unwind to the start of a loop's iteration, as recorded in its record.
+ *
+ * Returns 0 (with an error set) if that has already been unwound.
+ */
+static int _tl_loop_unwind(tl_interp *in, tl_object *record, const char *what) {
+	if(!tl_unwind(in, _tl_loop_conts(record), _tl_loop_rescue(record))) {
+		tl_error_set(in, tl_new_sym(in, what));
+		return 0;
+	}
+	in->values = _tl_loop_values(record);
+	return 1;
+}
+
+static void _tl_cf_loop_k(tl_interp *in, tl_object *vals, tl_object *args) {
+	tl_object *frm = TL_EMPTY_LIST, *vars = TL_EMPTY_LIST, *record;
+	for(tl_list_iter(tl_first(args), binding)) {
+		tl_object *kv = tl_new_pair(in, tl_first(binding), tl_first(vals));
+		frm = tl_new_pair(in, kv, frm);
+		vars = tl_new_pair(in, kv, vars);
+		vals = tl_next(vals);
+	}
+	/* Keep the variables in binding order, so recur can rebind them in order */
+	vars = tl_list_rvs(in, vars);
+	record = tl_new_pair(in, in->conts, tl_new_pair(in, in->values, tl_new_pair(in, in->rescue,
+			tl_new_pair(in, vars, tl_list_rvs(in, tl_next(args))))));
+	frm = tl_new_pair(in, tl_new_pair(in, tl_new_sym_name(in, _tl_loop_name(in)), record), frm);
+	_tl_loop_body(in, record, tl_new_pair(in, frm, in->env));
+}
+
+TL_CF(loop, "loop") {
+	tl_object *inits = TL_EMPTY_LIST;
+	arity_1(in, args, "loop");
+	for(tl_list_iter(tl_first(args), binding)) {
+		if(!binding || !tl_is_pair(binding) || !tl_is_sym(tl_first(binding))) {
+			tl_error_set(in, tl_new_pair(in, tl_new_sym(in, "bad loop binding"), binding));
+			tl_cfunc_return(in, in->false_);
+		}
+		inits = tl_new_pair(in, tl_new_pair(in, tl_first(tl_next(binding)), in->true_), inits);
+	}
+	tl_eval_all_args(in, tl_list_rvs(in, inits), args, _tl_cf_loop_k);
+}
+
+TL_CFBV_N(recur, "recur", 0, -1) {
+	tl_object *loop_env, *record = _tl_loop_find(in, &loop_env);
+	if(!record) {
+		tl_error_set(in, tl_new_sym(in, "recur outside loop"));
+		tl_cfunc_return(in, in->false_);
+	}
+	tl_object *vars = _tl_loop_vars(record);
+	if(tl_list_len(vars) != argc) {
+		tl_error_set(in, tl_new_pair(in, tl_new_sym(in, "bad recur arity"), tl_new_int(in, argc)));
+		tl_cfunc_return(in, in->false_);
+	}
+	if(!_tl_loop_unwind(in, record, "recur outside loop")) tl_cfunc_return(in, in->false_);
+	for(tl_list_iter(vars, kv)) {
+		kv->next = *argv++;
+	}
+	_tl_loop_body(in, record, loop_env);
+}
+
+TL_CFBV_N(break, "break", 0, 1) {
+	tl_object *loop_env, *record = _tl_loop_find(in, &loop_env);
+	if(!record) {
+		tl_error_set(in, tl_new_sym(in, "break outside loop"));
+		tl_cfunc_return(in, in->false_);
+	}
+	if(!_tl_loop_unwind(in, record, "break outside loop")) tl_cfunc_return(in, in->false_);
+	tl_cfunc_return(in, argc ? argv[0] : in->false_);
+}
+
+/* state is ((cond . body) . self), this very continuation, so that it can be
+ * pushed again for each iteration without allocating another. */
+static void _tl_cf_while_k(tl_interp *in, tl_object *result, tl_object *state) {
+	tl_object *cond = tl_first(tl_first(state)), *body = tl_next(tl_first(state));
+	if(!_unboolify(in, tl_first(result))) return;  /* The last body value remains */
+	if(!body) {
+		tl_push_apply(in, 1, tl_next(state), in->env);
+		tl_push_apply(in, TL_APPLY_PUSH_EVAL, cond, in->env);
+		return;
+	}
+	in->values = tl_next(in->values);  /* Drop the previous body value */
+	tl_push_apply(in, 1, tl_next(state), in->env);
+	tl_push_apply(in, TL_APPLY_PUSH_EVAL, cond, in->env);
+	_tl_push_body(in, body, in->env);
+}
+
+/* A while has no frame of its own (so definitions in its body stay in the
+ * enclosing one), and thus no loop record: break and recur within it apply to
+ * the enclosing loop, if any. Use call/ec to leave a while early. */
+TL_CF(while, "while") {
+	tl_object *state = tl_new_pair(in, args, TL_EMPTY_LIST);
+	arity_1(in, args, "while");
+	state->next = tl_new_then(in, _tl_cf_while_k, state, "tl-while");
+	tl_values_push(in, in->false_);  /* The value if the body never runs */
+	tl_push_apply(in, 1, tl_next(state), in->env);
+	tl_push_eval(in, tl_first(args), in->env);
+}
+
+#ifndef TL_QQ_MAX_DEPTH
+/** The deepest nesting of lists a quasiquote template may have.
+ *
+ * Templates are walked recursively on the C stack, so a deeper one is
+ * rejected with an error rather than risk overflowing it.
+ */
+#define TL_QQ_MAX_DEPTH 256
+#endif
+
+/** Test whether `obj` is a form `(nm x)`, for nm one of the quasiquote markers. */
+static int _tl_qq_is(tl_object *obj, tl_name *nm) {
+	return obj && tl_is_pair(obj) && tl_is_sym(tl_first(obj)) && tl_first(obj)->nm == nm;
+}
+
+/** Collect the expressions unquoted anywhere in the list `tmpl`.
+ *
+ * They're prepended to `*exprs` as syntactic `(expr . true)` pairs, in walk
+ * order (thus reversed), ready for `tl_eval_all_args`. Returns 0, having set
+ * the error, if `tmpl` nests deeper than ::TL_QQ_MAX_DEPTH.
+ */
+static int _tl_qq_collect(tl_interp *in, tl_object *tmpl, tl_object **exprs, int depth, tl_name *uq, tl_name *uqs) {
+	if(depth >= TL_QQ_MAX_DEPTH) {
+		tl_error_set(in, tl_new_pair(in, tl_new_sym(in, "quasiquote too deep"), tmpl));
+		return 0;
+	}
+	for(; tmpl && tl_is_pair(tmpl); tmpl = tl_next(tmpl)) {
+		tl_object *elem = tl_first(tmpl);
+		if(_tl_qq_is(elem, uq) || _tl_qq_is(elem, uqs)) {
+			*exprs = tl_new_pair(in, tl_new_pair(in, tl_first(tl_next(elem)), in->true_), *exprs);
+		} else if(elem && tl_is_pair(elem)) {
+			if(!_tl_qq_collect(in, elem, exprs, depth + 1, uq, uqs)) return 0;
+		}
+	}
+	return 1;
+}
+
+/** Rebuild the list `tmpl`, substituting values from `*vals` in walk order.
+ *
+ * Only called on a template `_tl_qq_collect` accepted, so its recursion is
+ * bounded by ::TL_QQ_MAX_DEPTH too.
+ */
+static tl_object *_tl_qq_build(tl_interp *in, tl_object *tmpl, tl_object **vals, tl_name *uq, tl_name *uqs) {
+	tl_object *head = TL_EMPTY_LIST, *tail = TL_EMPTY_LIST;
+#define _tl_qq_append(v) do { \
+	tl_object *cell = tl_new_pair(in, (v), TL_EMPTY_LIST); \
+	if(tail) tail->next = cell; else head = cell; \
+	tail = cell; \
+} while(0)
+	for(; tmpl && tl_is_pair(tmpl); tmpl = tl_next(tmpl)) {
+		tl_object *elem = tl_first(tmpl);
+		if(_tl_qq_is(elem, uq)) {
+			_tl_qq_append(tl_first(*vals));
+			*vals = tl_next(*vals);
+		} else if(_tl_qq_is(elem, uqs)) {
+			for(tl_object *l = tl_first(*vals); l && tl_is_pair(l); l = tl_next(l)) {
+				_tl_qq_append(tl_first(l));
+			}
+			*vals = tl_next(*vals);
+		} else if(elem && tl_is_pair(elem)) {
+			_tl_qq_append(_tl_qq_build(in, elem, vals, uq, uqs));
+		} else {
+			_tl_qq_append(elem);
+		}
+	}
+#undef _tl_qq_append
+	/* Keep the tail of a dotted template */
+	if(tail) tail->next = tmpl; else head = tmpl;
+	return head;
+}
+
+static void _tl_qq_names(tl_interp *in, tl_name **uq, tl_name **uqs) {
+	*uq = tl_ns_resolve(in, &in->ns, (tl_buffer) {"unquote", 7});
+	*uqs = tl_ns_resolve(in, &in->ns, (tl_buffer) {"unquote-splicing", 16});
+}
+
+static void _tl_cf_quasiquote_k(tl_interp *in, tl_object *vals, tl_object *tmpl) {
+	tl_name *uq, *uqs;
+	_tl_qq_names(in, &uq, &uqs);
+	tl_cfunc_return(in, _tl_qq_build(in, tmpl, &vals, uq, uqs));
+}
+
+TL_CF(quasiquote, "quasiquote") {
+	tl_object *tmpl = tl_first(args), *exprs = TL_EMPTY_LIST;
+	tl_name *uq, *uqs;
+	arity_1(in, args, "quasiquote");
+	_tl_qq_names(in, &uq, &uqs);
+	if(_tl_qq_is(tmpl, uq)) {
+		tl_push_eval(in, tl_first(tl_next(tmpl)), in->env);
+		return;
+	}
+	if(!_tl_qq_collect(in, tmpl, &exprs, 0, uq, uqs)) return;
+	if(!exprs) tl_cfunc_return(in, tmpl);
+	tl_eval_all_args(in, tl_list_rvs(in, exprs), tmpl, _tl_cf_quasiquote_k);
+}
+
 TL_CFBV(env, "env") {
 	tl_object *f = tl_first(args);
 	if(!f) {
@@ -219,6 +744,10 @@ TL_CFBV(setenv, "set-env!") {
 		tl_error_set(in, tl_new_pair(in, tl_new_sym(in, "setenv on non-func, -macro, or -cont"), first));
 		tl_cfunc_return(in, in->false_);
 	}
+	if(tl_is_frozen(first)) {
+		tl_error_set(in, tl_new_pair(in, tl_new_sym(in, "setenv on frozen object"), first));
+		tl_cfunc_return(in, in->false_);
+	}
 	if(tl_is_cont(first)) {
 		first->ret_env = next;
 	} else {
@@ -371,35 +900,33 @@ TL_CFBV(writec, "writec") {
 	tl_cfunc_return(in, in->true_);
 }
 
-TL_CFBV(add, "+") {
+TL_CFBV_N(add, "+", 0, -1) {
 	long res = 0;
-	for(tl_list_iter(args, val)) {
-		verify_type(in, val, int, "+");
-		res += val->ival;
+	for(size_t i = 0; i < argc; i++) {
+		verify_type(in, argv[i], int, "+");
+		res += argv[i]->ival;
 	}
 	tl_cfunc_return(in, tl_new_int(in, res));
 }
 
-TL_CFBV(sub, "-") {
-	long phase = 0;
+TL_CFBV_N(sub, "-", 0, -1) {
 	long res = 0;
-	for(tl_list_iter(args, val)) {
-		verify_type(in, val, int, "-");
-		if(!phase) {
-			res += val->ival;
-			phase = 1;
+	for(size_t i = 0; i < argc; i++) {
+		verify_type(in, argv[i], int, "-");
+		if(!i) {
+			res += argv[i]->ival;
 		} else {
-			res -= val->ival;
+			res -= argv[i]->ival;
 		}
 	}
 	tl_cfunc_return(in, tl_new_int(in, res));
 }
 
-TL_CFBV(mul, "*") {
+TL_CFBV_N(mul, "*", 0, -1) {
 	long res = 1;
-	for(tl_list_iter(args, val)) {
-		verify_type(in, val, int, "*");
-		res *= val->ival;
+	for(size_t i = 0; i < argc; i++) {
+		verify_type(in, argv[i], int, "*");
+		res *= argv[i]->ival;
 	}
 	tl_cfunc_return(in, tl_new_int(in, res));
 }
@@ -434,8 +961,8 @@ TL_CFBV(mod, "%") {
 	tl_cfunc_return(in, tl_new_int(in, res));
 }
 
-TL_CFBV(eq, "=") {
-	tl_object *a = tl_first(args), *b = tl_first(tl_next(args));
+TL_CFBV_N(eq, "=", 2, 2) {
+	tl_object *a = argv[0], *b = argv[1];
 	if(tl_is_int(a) && tl_is_int(b)) {
 		tl_cfunc_return(in, _boolify(a->ival == b->ival));
 	}
@@ -445,8 +972,8 @@ TL_CFBV(eq, "=") {
 	tl_cfunc_return(in, _boolify(a == b));
 }
 
-TL_CFBV(less, "<") {
-	tl_object *a = tl_first(args), *b = tl_first(tl_next(args));
+TL_CFBV_N(less, "<", 2, 2) {
+	tl_object *a = argv[0], *b = argv[1];
 	if(tl_is_int(a) && tl_is_int(b)) {
 		tl_cfunc_return(in, _boolify(a->ival < b->ival));
 	}
@@ -457,8 +984,8 @@ TL_CFBV(less, "<") {
 	tl_cfunc_return(in, in->false_);
 }
 
-TL_CFBV(nand, "nand") {
-	int a = _unboolify(in, tl_first(args)), b = _unboolify(in, tl_first(tl_next(args)));
+TL_CFBV_N(nand, "nand", 2, 2) {
+	int a = _unboolify(in, argv[0]), b = _unboolify(in, argv[1]);
 	tl_cfunc_return(in, _boolify(!(a && b)));
 }
 
@@ -501,6 +1028,38 @@ TL_CFBV(read, "read") {
 	tl_read(in);  /* Returns into the same stack */
 }
 
+TL_CFBV(serialize, "serialize") {
+	tl_form_writer w;
+	tl_object *ret;
+
+	arity_1(in, args, "serialize");
+	tl_form_writer_init(in, &w);
+	w.shared = 1;
+	if(!tl_form_encode(in, &w, tl_first(args))) {
+		tl_form_writer_free(in, &w);
+		tl_error_set(in, tl_new_sym(in, "serialize unencodable"));
+		tl_cfunc_return(in, in->false_);
+	}
+	ret = tl_new_sym_data(in, (const char *)w.data, w.len);
+	tl_form_writer_free(in, &w);
+	tl_cfunc_return(in, ret);
+}
+
+TL_CFBV(deserialize, "deserialize") {
+	tl_form_reader r;
+	tl_object *ret;
+
+	arity_1(in, args, "deserialize");
+	verify_type(in, tl_first(args), sym, "deserialize");
+	if(!tl_form_reader_init(&r, tl_first(args)->nm->here.data, tl_first(args)->nm->here.len) || tl_form_decode(in, &r, &ret) <= 0) {
+		tl_form_reader_free(in, &r);
+		tl_error_set(in, tl_new_sym(in, "deserialize malformed"));
+		tl_cfunc_return(in, in->false_);
+	}
+	tl_form_reader_free(in, &r);
+	tl_cfunc_return(in, ret);
+}
+
 TL_CFBV(load_mod, "load-mod") {
 #ifdef CONFIG_MODULES
 	tl_object *name = tl_first(args);
@@ -525,7 +1084,7 @@ TL_CFBV(rescue, "rescue") {
 	func = tl_first(args);
 	verify_type(in, func, callable, "rescue");
 
-	cont = tl_new_cont(in, in->env, in->conts, in->values);
+	cont = tl_new_ec(in);
 	tl_rescue_push(in, cont);
 	tl_push_apply(in, TL_APPLY_DROP_RESCUE, TL_EMPTY_LIST, TL_EMPTY_LIST);
 	tl_push_apply(in, 0, func, in->env);
@@ -40,7 +40,7 @@ void tl_dbg_print(tl_object *obj, int level) {
 		case TL_CFUNC:
 		case TL_CFUNC_BYVAL:
 		case TL_THEN:
-			fprintf(stderr, "%s: %p\n", obj->kind == TL_CFUNC ? "CFUNC" : (obj->kind == TL_CFUNC_BYVAL? "CFUNC_BYVAL" : "THEN"), obj->cfunc);
+			fprintf(stderr, "%s: %p\n", obj->kind == TL_CFUNC ? "CFUNC" : (obj->kind == TL_CFUNC_BYVAL? "CFUNC_BYVAL" : "THEN"), obj->ent ? (void *) obj->ent->fnv : (void *) obj->cfunc);
 			_indent(level + 1);
 			fprintf(stderr, "state:\n");
 			tl_dbg_print(obj->state, level + 2);
@@ -54,7 +54,7 @@ void tl_dbg_print(tl_object *obj, int level) {
 			tl_dbg_print(obj->args, level + 2);
 			if(obj->kind == TL_MACRO) {
 				_indent(level + 1);
-				fprintf(stderr, "envn:\n");
+				fprintf(stderr, tl_is_macro_pure(obj) ? "expansions:\n" : "envn:\n");
 				tl_dbg_print(obj->envn, level + 2);
 			}
 			_indent(level + 1);
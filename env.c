@@ -1,5 +1,6 @@
 #include <string.h>
 #include <stdio.h>
+#include <assert.h>
 
 #include "tinylisp.h"
 
@@ -16,9 +17,15 @@ tl_object *tl_env_get_kv(tl_interp *in, tl_object *env, tl_object *nm) {
 	return NULL;
 }
 
+/* Frozen bindings (see tl_interp_freeze) are never changed; instead, the new
+ * value shadows them in the interpreter's own top frame. */
 tl_object *tl_env_set_global(tl_interp *in, tl_object *env, tl_object *nm, tl_object *val) {
 	tl_object *kv = tl_env_get_kv(in, env, nm);
 	if(kv && tl_is_pair(kv)) {
+		if(tl_is_frozen(kv)) {
+			tl_env_set_local(in, in->top_env, nm, val);
+			return env;
+		}
 		kv->next = val;
 		return env;
 	}
@@ -27,14 +34,18 @@ tl_object *tl_env_set_global(tl_interp *in, tl_object *env, tl_object *nm, tl_ob
 	}
 	for(tl_list_iter(env, frame)) {
 		if(!tl_next(l_frame)) {
-			l_frame->first = tl_frm_set(in, frame, nm, val);
+			if(tl_is_frozen(l_frame)) {
+				tl_env_set_local(in, in->top_env, nm, val);
+			} else {
+				l_frame->first = tl_frm_set(in, frame, nm, val);
+			}
 		}
 	}
 	return env;
 }
 
 tl_object *tl_env_set_local(tl_interp *in, tl_object *env, tl_object *nm, tl_object *val) {
-	if(!env) {
+	if(!env || tl_is_frozen(env)) {
 		env = tl_new_pair(in, TL_EMPTY_LIST, env);
 	}
 	env->first = tl_frm_set(in, tl_first(env), nm, val);
@@ -44,6 +55,7 @@ tl_object *tl_env_set_local(tl_interp *in, tl_object *env, tl_object *nm, tl_obj
 tl_object *tl_frm_set(tl_interp *in, tl_object *frm, tl_object *nm, tl_object *val) {
 	for(tl_list_iter(frm, kv)) {
 		if(kv && tl_is_pair(kv) && tl_is_sym(tl_first(kv)) && tl_sym_eq(tl_first(kv), nm)) {
+			if(tl_is_frozen(kv)) break;
 			kv->next = val;
 			return frm;
 		}
@@ -61,8 +73,76 @@ tl_object *tl_env_top_pair(tl_interp *in) {
 
 void tl_env_merge(tl_interp *in, tl_object *pair, tl_object *frame) {
 	if(!tl_is_pair(pair)) return;
+	if(tl_is_frozen(pair)) pair = in->top_env;
 	while(frame) {
 		pair->first = tl_new_pair(in, tl_first(frame), tl_first(pair));
 		frame = tl_next(frame);
 	}
 }
+
+/** Register a definition to load the first time `name` is referenced unbound.
+ *
+ * `data` is a stream of encoded forms (see ::tl_form_encode), usually just a
+ * `define` of `name`. When evaluation finds `name` unbound, it evaluates these
+ * forms in the top-level environment, and then looks `name` up again there.
+ * This lets a library like std.tl bind its functions without building them
+ * until (and unless) they're used. Each definition is loaded at most once, and
+ * registering `name` again replaces any earlier definition not yet loaded.
+ *
+ * The data isn't copied, and must stay valid as long as the interpreter (and
+ * any interpreter started from it with ::tl_interp_init_base). Definitions
+ * not yet loaded are saved by ::tl_image_save as they are, but aren't visible
+ * to `tl-env` or `set!` (which binds the name anew, so the definition is never
+ * loaded).
+ */
+void tl_autoload(tl_interp *in, tl_name *name, const void *data, size_t len) {
+	if(in->nautoloads >= in->szautoloads) {
+		in->szautoloads = (in->szautoloads << 1) | 63;
+		in->autoloads = tl_alloc_realloc(in, in->autoloads, in->szautoloads * sizeof(*in->autoloads));
+		assert(in->autoloads);
+	}
+	in->autoloads[in->nautoloads].data = data;
+	in->autoloads[in->nautoloads].len = len;
+	*tl_ptrmap_slot(in, &in->autoload, name) = ++in->nautoloads;
+}
+
+static void _tl_autoload_bound_k(tl_interp *in, tl_object *args, tl_object *sym) {
+	tl_object *kv = tl_env_get_kv(in, in->top_env, sym);
+	if(!kv) {
+		tl_error_set(in, tl_new_pair(in, tl_new_sym(in, "unknown var"), sym));
+		tl_cfunc_return(in, in->false_);
+	}
+	tl_cfunc_return(in, tl_next(kv));
+}
+
+static void _tl_autoload_k(tl_interp *in, tl_object *args, tl_object *state) {
+	tl_object *forms = tl_next(state);
+	tl_push_apply(in, 1, tl_new_then(in, _tl_autoload_bound_k, tl_first(state), "tl_autoload"), in->top_env);
+	for(tl_list_iter(forms, form)) {
+		tl_push_apply(in, l_form == forms ? TL_APPLY_PUSH_EVAL : TL_APPLY_DROP_EVAL, form, in->top_env);
+	}
+}
+
+/** Start loading the definition of an unbound symbol, if there is one.
+ *
+ * This is used by ::tl_push_eval . If `sym` has a definition registered with
+ * ::tl_autoload , this pushes a single continuation that evaluates it and then
+ * pushes the value of `sym`, and returns nonzero; otherwise, returns 0.
+ */
+int _tl_autoload_push(tl_interp *in, tl_object *sym) {
+	size_t *slot, idx;
+	tl_form_reader r;
+	tl_object *form, *forms = TL_EMPTY_LIST;
+	int res;
+
+	if(!(idx = tl_ptrmap_get(&in->autoload, sym->nm))) return 0;
+	slot = tl_ptrmap_slot(in, &in->autoload, sym->nm);
+	*slot = 0;
+	tl_form_reader_init(&r, in->autoloads[idx - 1].data, in->autoloads[idx - 1].len);
+	while((res = tl_form_decode(in, &r, &form)) > 0) forms = tl_new_pair(in, form, forms);
+	tl_form_reader_free(in, &r);
+	if(res < 0 || !forms) return 0;
+	/* forms is reversed, so the last form (whose value is passed on) is first */
+	tl_push_apply(in, 0, tl_new_then(in, _tl_autoload_k, tl_new_pair(in, sym, forms), "tl_autoload"), in->top_env);
+	return 1;
+}
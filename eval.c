@@ -40,6 +40,7 @@ int tl_push_eval(tl_interp *in, tl_object *expr, tl_object *env) {
 	if(tl_is_sym(expr)) {  /* Variable binding */
 		tl_object *binding = tl_env_get_kv(in, env, expr);
 		if(!binding) {
+			if(_tl_autoload_push(in, expr)) return TL_RESULT_AGAIN;
 			tl_error_set(in, tl_new_pair(in, tl_new_sym(in, "unknown var"), expr));
 			return TL_RESULT_DONE;
 		}
@@ -121,7 +122,9 @@ int tl_push_eval(tl_interp *in, tl_object *expr, tl_object *env) {
  *   the host environment that a character is needed; it is expected to be
  *   provided as a `TL_INT` on top of the value stack when `tl_apply_next` is
  *   subsequently called. The default implementation of `tl_run_until_done`
- *   handles this transparently by invoking the tl_interp::readf function.
+ *   handles this transparently by invoking the tl_interp::readf function. A
+ *   putback character, or one left in tl_interp::input_buf , is provided
+ *   without returning to the host.
  */
 void tl_push_apply(tl_interp *in, long len, tl_object *expr, tl_object *env) {
 	in->conts = tl_new_pair(in, tl_new_pair(in, tl_new_int(in, len), tl_new_pair(in, expr, env)), in->conts);
@@ -132,6 +135,220 @@ void tl_push_apply(tl_interp *in, long len, tl_object *expr, tl_object *env) {
 	}
 }
 
+/** Resolve an expression that needs no continuation, if possible.
+ *
+ * Integers, callables, and symbols can be evaluated without pushing anything
+ * to the continuation stack; for those, this returns nonzero and stores the
+ * direct value in `*value`. An unbound symbol sets the error (as
+ * `tl_push_eval` would) and still returns nonzero, with `*value` set to
+ * `in->false_`. Anything else (applications, the unevaluable, and symbols
+ * whose definitions are yet to be autoloaded) returns 0, and should be handed
+ * to `tl_eval_and_then`.
+ */
+static int _tl_eval_immediate(tl_interp *in, tl_object *expr, tl_object **value) {
+	if(tl_is_int(expr) || tl_is_callable(expr)) {
+		*value = expr;
+		return 1;
+	}
+	if(tl_is_sym(expr)) {
+		tl_object *binding = tl_env_get_kv(in, in->env, expr);
+		if(!binding) {
+			if(tl_ptrmap_get(&in->autoload, expr->nm)) return 0;  /* See tl_autoload */
+			tl_error_set(in, tl_new_pair(in, tl_new_sym(in, "unknown var"), expr));
+			*value = in->false_;
+			return 1;
+		}
+		*value = tl_next(binding);
+		return 1;
+	}
+	return 0;
+}
+
+#ifndef TL_ARGV_INLINE
+/** The most arguments an array-convention builtin (see ::TL_CFBV_N) will
+ * receive from an array on the C stack; larger calls allocate one.
+ */
+#define TL_ARGV_INLINE 16
+#endif
+
+/** Check the arity of an array-convention builtin, raising an error if bad. */
+static int _tl_argv_arity_ok(tl_interp *in, tl_object *callex, size_t argc) {
+	const tl_init_ent *ent = callex->ent;
+	if((long) argc < ent->min || (ent->max >= 0 && (long) argc > ent->max)) {
+		tl_error_set(in, tl_new_pair(in, tl_new_sym(in, "bad arity"), tl_new_pair(in, tl_new_int(in, argc), callex)));
+		return 0;
+	}
+	return 1;
+}
+
+/** Call an array-convention builtin with a TL list of direct arguments. */
+static void _tl_apply_argv(tl_interp *in, tl_object *callex, tl_object *args) {
+	tl_object *buf[TL_ARGV_INLINE], **argv = buf;
+	size_t argc = tl_list_len(args), i = 0;
+
+	if(!_tl_argv_arity_ok(in, callex, argc)) return;
+	if(argc > TL_ARGV_INLINE && !(argv = tl_alloc_malloc(in, argc * sizeof(tl_object *)))) {
+		tl_error_set(in, tl_new_sym(in, "out of memory"));
+		return;
+	}
+	for(tl_list_iter(args, arg)) argv[i++] = arg;
+	callex->ent->fnv(in, argc, argv);
+	if(argv != buf) tl_alloc_free(in, argv);
+}
+
+/** Call an array-convention builtin straight from the value stack, if possible.
+ *
+ * This succeeds (returning nonzero) when each of the top `len` values is
+ * direct or resolvable by `_tl_eval_immediate`, in which case they are
+ * popped and passed to the function without building a list. Otherwise,
+ * nothing is changed and 0 is returned, and the caller should take the
+ * general path through `_tl_eval_all_args`.
+ */
+static int _tl_apply_argv_values(tl_interp *in, tl_object *callex, long len) {
+	tl_object *argv[TL_ARGV_INLINE], *vals = in->values;
+	long i;
+
+	if(len > TL_ARGV_INLINE) return 0;
+	/* The last argument is on top */
+	for(i = len - 1; i >= 0; i--) {
+		argv[i] = tl_first(vals);
+		if(tl_next(argv[i]) == in->true_ && !(tl_is_int(tl_first(argv[i])) || tl_is_callable(tl_first(argv[i])) || tl_is_sym(tl_first(argv[i])))) return 0;
+		vals = tl_next(vals);
+	}
+	in->values = vals;
+
+	if(!_tl_argv_arity_ok(in, callex, len)) return 1;
+	for(i = 0; i < len; i++) {
+		if(tl_next(argv[i]) == in->true_) {
+			_tl_eval_immediate(in, tl_first(argv[i]), &argv[i]);
+			if(tl_has_error(in)) return 1;
+		} else {
+			argv[i] = tl_first(argv[i]);
+		}
+	}
+	callex->ent->fnv(in, len, argv);
+	return 1;
+}
+
+/* The special forms recognized by `_tl_apply_intrinsic` (see builtin.c) */
+void tl_cf_if(tl_interp *, tl_object *, tl_object *);
+void tl_cf_define(tl_interp *, tl_object *, tl_object *);
+void tl_cf_set(tl_interp *, tl_object *, tl_object *);
+void tl_cf_lambda(tl_interp *, tl_object *, tl_object *);
+int _unboolify(tl_interp *, tl_object *);
+
+/** Bind `key` to `val`, as `tl-define` (if `local`) or `tl-set!` would. */
+static void _tl_apply_bind(tl_interp *in, int local, tl_object *key, tl_object *val) {
+	in->env = local ? tl_env_set_local(in, in->env, key, val) : tl_env_set_global(in, in->env, key, val);
+	tl_values_push(in, in->true_);
+}
+
+/** Apply one of the core special forms directly from the value stack.
+ *
+ * When `callex` is the original `tl-if`, `tl-define`, `tl-set!`, or
+ * `tl-lambda` (not merely something bound to the same name), it is handled
+ * here instead of by the general by-name path, which would build, unwrap, and
+ * reverse an argument list, then allocate a C continuation to evaluate the
+ * subexpression. Immediately resolvable subexpressions (see
+ * `_tl_eval_immediate`) are evaluated in place; otherwise, one of the
+ * `TL_APPLY_IF`, `TL_APPLY_DEFINE`, or `TL_APPLY_SET` flags finishes the job.
+ *
+ * The semantics are the same as the builtins'. Returns 0 for unusual
+ * applications (odd arity, direct or ill-typed arguments), leaving the value
+ * stack untouched for the builtin itself to handle (and report).
+ */
+static int _tl_apply_intrinsic(tl_interp *in, tl_object *callex, long len, tl_object *env) {
+	tl_object *vals = in->values, *value;
+	void (*cf)(tl_interp *, tl_object *, tl_object *) = callex->cfunc;
+
+	if(cf == tl_cf_if) {
+		tl_object *iff, *ift, *cond;
+		if(len != 3) return 0;
+		iff = tl_first(vals);
+		ift = tl_first(tl_next(vals));
+		cond = tl_first(tl_next(tl_next(vals)));
+		if(tl_next(iff) != in->true_ || tl_next(ift) != in->true_ || tl_next(cond) != in->true_) return 0;
+		in->values = tl_next(tl_next(tl_next(vals)));
+		if(_tl_eval_immediate(in, tl_first(cond), &value)) {
+			if(!tl_has_error(in)) tl_push_eval(in, tl_first(_unboolify(in, value) ? ift : iff), env);
+		} else {
+			/* The branches are still reachable from vals */
+			tl_push_apply(in, TL_APPLY_IF, vals, env);
+			tl_push_eval(in, tl_first(cond), env);
+		}
+		return 1;
+	}
+
+	if(cf == tl_cf_define || cf == tl_cf_set) {
+		tl_object *val, *key;
+		if(len != 2) return 0;
+		val = tl_first(vals);
+		key = tl_first(tl_next(vals));
+		if(tl_next(val) != in->true_ || tl_next(key) != in->true_ || !tl_is_sym(tl_first(key))) return 0;
+		in->values = tl_next(tl_next(vals));
+		if(_tl_eval_immediate(in, tl_first(val), &value)) {
+			if(!tl_has_error(in)) _tl_apply_bind(in, cf == tl_cf_define, tl_first(key), value);
+		} else {
+			tl_push_apply(in, cf == tl_cf_define ? TL_APPLY_DEFINE : TL_APPLY_SET, tl_first(key), env);
+			tl_push_eval(in, tl_first(val), env);
+		}
+		return 1;
+	}
+
+	if(cf == tl_cf_lambda) {
+		tl_object *body = TL_EMPTY_LIST;
+		long i;
+		if(len < 1) return 0;
+		for(i = 0; i < len; i++, vals = tl_next(vals)) {
+			if(tl_next(tl_first(vals)) != in->true_) return 0;
+		}
+		/* The last body expression is on top */
+		for(i = 0; i < len - 1; i++) {
+			body = tl_new_pair(in, tl_first(tl_first(in->values)), body);
+			in->values = tl_next(in->values);
+		}
+		tl_values_pop_into(in, value);
+		tl_values_push(in, tl_new_func(in, value, body, env));
+		return 1;
+	}
+
+	return 0;
+}
+
+/** Test whether two argument lists consist of the very same objects. */
+static int _tl_args_same(tl_object *a, tl_object *b) {
+	for(; a && b; a = tl_next(a), b = tl_next(b)) {
+		if(tl_first(a) != tl_first(b)) return 0;
+	}
+	return !a && !b;
+}
+
+/** C continuation receiving the expansion of a pure macro.
+ *
+ * `state` is `(macro . args)`. The expansion is remembered on the macro (see
+ * ::tl_new_macro_pure) and then evaluated in place of the application.
+ */
+static void _tl_macro_pure_k(tl_interp *in, tl_object *result, tl_object *state) {
+	tl_object *macro = tl_first(state), *expansion = tl_first(result);
+	tl_object *cache;
+	size_t n = 1;
+
+	if(tl_is_frozen(macro)) {
+		/* Shared read-only (see tl_interp_freeze); expand every time. */
+		tl_push_eval(in, expansion, in->env);
+		return;
+	}
+	cache = tl_new_pair(in, tl_new_pair(in, tl_next(state), expansion), macro->envn);
+	for(tl_object *site = cache; tl_next(site); site = tl_next(site), n++) {
+		if(n >= TL_MACRO_CACHE_MAX) {
+			site->next = TL_EMPTY_LIST;
+			break;
+		}
+	}
+	macro->envn = cache;
+	tl_push_eval(in, expansion, in->env);
+}
+
 /** C continuation for calling a function.
  *
  * This is invoked after the value stack has been verified to be all syntactic,
@@ -154,10 +371,26 @@ void _tl_apply_next_body_callable_k(tl_interp *in, tl_object *args, tl_object *c
 
 	/* Handle builtins */
 	if(tl_is_cfunc(callex) || tl_is_cfunc_byval(callex) || tl_is_then(callex)) {
+		if(callex->ent) {
+			_tl_apply_argv(in, callex, args);
+			return;
+		}
 		callex->cfunc(in, args, callex->state);
 		return;
 	}
 
+	/* Pure macros: reuse a previous expansion of these very arguments, or
+	 * arrange to remember this one */
+	if(tl_is_macro_pure(callex)) {
+		for(tl_list_iter(callex->envn, site)) {
+			if(_tl_args_same(tl_first(site), args)) {
+				tl_push_eval(in, tl_next(site), env);
+				return;
+			}
+		}
+		tl_push_apply(in, 1, tl_new_then(in, _tl_macro_pure_k, tl_new_pair(in, callex, args), "_tl_macro_pure_k"), env);
+	}
+
 	/* Determine if arguments are legal and bind them */
 	if(tl_is_pair(callex->args)) {
 		char is_improp = 0;
@@ -194,7 +427,7 @@ void _tl_apply_next_body_callable_k(tl_interp *in, tl_object *args, tl_object *c
 	}
 
 	/* For macros: before losing the old one, bind the env */
-	if(callex->envn) frm = tl_new_pair(in, tl_new_pair(in, callex->envn, env), frm);
+	if(tl_is_sym(callex->envn)) frm = tl_new_pair(in, tl_new_pair(in, callex->envn, env), frm);
 
 	/* ...and add the frame into the env, creating a new env */
 	env = tl_new_pair(in, frm, callex->env);
@@ -206,6 +439,339 @@ void _tl_apply_next_body_callable_k(tl_interp *in, tl_object *args, tl_object *c
 	}
 }
 
+/** Invalidate the state of an escape continuation, releasing what it holds.
+ *
+ * Frozen state (see `tl_interp_freeze`) is shared with other interpreters, so
+ * it can't be changed; unless it was already invalidated, this raises an
+ * error instead.
+ */
+static void _tl_ec_invalidate(tl_interp *in, tl_object *state) {
+	if(!state->first && !state->next) return;
+	if(tl_is_frozen(state)) {
+		tl_error_set(in, tl_new_pair(in, tl_new_sym(in, "escape continuation frozen"), state));
+		return;
+	}
+	state->first = state->next = TL_EMPTY_LIST;
+}
+
+static void _tl_ec_invoke(tl_interp *, tl_object *, tl_object *);
+
+/** Unwind the continuation and rescue stacks to `conts` and `rescue`.
+ *
+ * These must be the stacks as they were earlier in the running computation,
+ * and thus tails of the current ones; if `conts` isn't, this returns 0 and
+ * changes nothing. Every escape continuation whose extent is left--one marked
+ * by a `TL_APPLY_EXIT_EC`, or a `tl-rescue` handler, unwound past--is
+ * invalidated, so none of them can return into what was unwound.
+ */
+int tl_unwind(tl_interp *in, tl_object *conts, tl_object *rescue) {
+	tl_object *c, *r;
+	for(c = in->conts; c != conts; c = tl_next(c)) {
+		if(!c) return 0;
+	}
+	for(c = in->conts; c != conts; c = tl_next(c)) {
+		tl_object *cont = tl_first(c);
+		if(tl_first(cont)->ival == TL_APPLY_EXIT_EC) _tl_ec_invalidate(in, tl_first(tl_next(cont)));
+	}
+	for(r = in->rescue; r && r != rescue; r = tl_next(r));
+	if(r == rescue) {
+		for(r = in->rescue; r != rescue; r = tl_next(r)) {
+			tl_object *ec = tl_first(r);
+			if(tl_is_cfunc_byval(ec) && ec->cfunc == _tl_ec_invoke) _tl_ec_invalidate(in, ec->state);
+		}
+	}
+	in->conts = conts;
+	in->rescue = rescue;
+	return 1;
+}
+
+/** C function behind an escape continuation (see `tl_new_ec`). */
+static void _tl_ec_invoke(tl_interp *in, tl_object *args, tl_object *state) {
+	tl_object *rest = tl_next(state);
+	if(rest && tl_is_frozen(state)) {
+		tl_error_set(in, tl_new_pair(in, tl_new_sym(in, "escape continuation frozen"), state));
+		tl_cfunc_return(in, in->false_);
+	}
+	if(!rest || !tl_unwind(in, tl_first(state), tl_next(tl_next(rest)))) {
+		tl_error_set(in, tl_new_sym(in, "escape continuation invoked outside its extent"));
+		tl_cfunc_return(in, in->false_);
+	}
+	in->values = tl_first(rest);
+	in->env = tl_first(tl_next(rest));
+	_tl_ec_invalidate(in, state);
+	tl_cfunc_return(in, args ? tl_first(args) : in->false_);
+}
+
+/** Create an escape continuation.
+ *
+ * Like a `TL_CONT` (see `tl_new_cont`), calling this object with a value
+ * resumes the computation at the point it was created, with that value--but
+ * only once, and only from within the dynamic extent of the computation it
+ * was made for; thereafter (or after `TL_APPLY_EXIT_EC` is reached, or an
+ * outer escape unwinds past it), calling it is an error. Thus it can only
+ * ever unwind the stacks, and it releases them as soon as it is no longer
+ * usable, rather than for as long as the object lives. This makes it cheaper
+ * for early return, breaking out of loops, and error recovery.
+ *
+ * It is a `TL_CFUNC_BYVAL` whose state is
+ * `(conts . (values . (env . rescue)))`, captured from the interpreter (or
+ * `()` once invalidated). The rescue stack is restored as well, so that
+ * escaping past a `tl-rescue` doesn't leave its handler in place.
+ */
+tl_object *tl_new_ec(tl_interp *in) {
+	tl_object *ec = _tl_new_cfunc_byval(in, _tl_ec_invoke, "tl-escape");
+	ec->state = tl_new_pair(in, in->conts, tl_new_pair(in, in->values, tl_new_pair(in, in->env, in->rescue)));
+	return ec;
+}
+
+/** The status of a task: `()` if runnable, `true_` if blocked, or `(ok . value)` once finished. */
+#define _tl_task_status(task) ((task)->state->first)
+/** The pair whose first is the list of tasks blocked in `tl-join` on a task. */
+#define _tl_task_waiters(task) tl_next((task)->state)
+/** The saved `(conts . (values . (env . rescue)))` of a task that isn't running. */
+#define _tl_task_ctx(task) tl_next(tl_next((task)->state))
+
+/** Create a (not yet runnable) task object with the given stacks. */
+static tl_object *_tl_new_task(tl_interp *in, tl_object *conts, tl_object *env) {
+	tl_object *task = _tl_new_cfunc_byval(in, tl_cfbv_join, "tl-task");
+	task->state = tl_new_pair(in, TL_EMPTY_LIST, tl_new_pair(in, TL_EMPTY_LIST,
+		tl_new_pair(in, conts, tl_new_pair(in, TL_EMPTY_LIST, tl_new_pair(in, env, TL_EMPTY_LIST)))
+	));
+	return task;
+}
+
+/** Append a task to the run queue.
+ *
+ * If no task is current, the running computation becomes the root task, as
+ * on the first spawn; a task left blocked by an earlier computation (which
+ * abandoned it) can be woken by a later one this way.
+ */
+static void _tl_task_enqueue(tl_interp *in, tl_object *task) {
+	tl_object *cell = tl_new_pair(in, task, TL_EMPTY_LIST);
+	if(!in->task) {
+		in->task = in->task_root = _tl_new_task(in, TL_EMPTY_LIST, TL_EMPTY_LIST);
+		in->task_fuel = in->task_quantum;
+	}
+	if(in->tasks) {
+		in->tasks_tail->next = cell;
+	} else {
+		in->tasks = cell;
+	}
+	in->tasks_tail = cell;
+}
+
+/** Save the interpreter's stacks into the current task. */
+static void _tl_task_save(tl_interp *in, tl_object *task) {
+	tl_object *ctx = _tl_task_ctx(task);
+	ctx->first = in->conts;
+	ctx = tl_next(ctx);
+	ctx->first = in->values;
+	ctx = tl_next(ctx);
+	ctx->first = in->env;
+	ctx->next = in->rescue;
+}
+
+/** Make a task current, restoring its stacks (and releasing the saved copy). */
+static void _tl_task_load(tl_interp *in, tl_object *task) {
+	tl_object *ctx = _tl_task_ctx(task);
+	in->conts = tl_first(ctx);
+	ctx->first = TL_EMPTY_LIST;
+	ctx = tl_next(ctx);
+	in->values = tl_first(ctx);
+	ctx->first = TL_EMPTY_LIST;
+	ctx = tl_next(ctx);
+	in->env = tl_first(ctx);
+	in->rescue = tl_next(ctx);
+	ctx->first = ctx->next = TL_EMPTY_LIST;
+	_tl_task_status(task) = TL_EMPTY_LIST;
+	in->task = task;
+	in->task_fuel = in->task_quantum;
+}
+
+/** Switch to the next runnable task, if any, returning nonzero if so.
+ *
+ * The current task must already be saved, queued, or finished.
+ */
+static int _tl_task_next(tl_interp *in) {
+	tl_object *task;
+	if(!in->tasks) return 0;
+	task = tl_first(in->tasks);
+	in->tasks = tl_next(in->tasks);
+	if(!in->tasks) in->tasks_tail = TL_EMPTY_LIST;
+	_tl_task_load(in, task);
+	return 1;
+}
+
+/** Make runnable all tasks blocked on `holder` (a pair whose first is the list of them).
+ *
+ * A frozen holder (see `tl_interp_freeze`) can't be changed, so this raises
+ * an error instead.
+ */
+static void _tl_task_wake(tl_interp *in, tl_object *holder) {
+	if(tl_is_frozen(holder)) {
+		tl_error_set(in, tl_new_pair(in, tl_new_sym(in, "wake on frozen object"), holder));
+		return;
+	}
+	for(tl_list_iter(tl_first(holder), task)) {
+		if(_tl_task_status(task) == in->true_) {
+			_tl_task_status(task) = TL_EMPTY_LIST;
+			_tl_task_enqueue(in, task);
+		}
+	}
+	holder->first = TL_EMPTY_LIST;
+}
+
+/** Block the current task on `holder` (see `_tl_task_wake`) and switch away.
+ *
+ * When woken, the task calls `retry` (with no arguments), which should
+ * attempt the operation again. If no other task is runnable, nothing could
+ * ever wake this one; this returns 0 without blocking in that case.
+ */
+static int _tl_task_park(tl_interp *in, tl_object *holder, tl_object *retry) {
+	if(!in->tasks) return 0;
+	tl_push_apply(in, 0, retry, in->env);
+	holder->first = tl_new_pair(in, in->task, tl_first(holder));
+	_tl_task_status(in->task) = in->true_;
+	_tl_task_save(in, in->task);
+	_tl_task_next(in);
+	return 1;
+}
+
+/** Record the outcome of a task and wake its joiners. */
+static void _tl_task_finish(tl_interp *in, tl_object *task, tl_object *ok, tl_object *value) {
+	_tl_task_status(task) = tl_new_pair(in, ok, value);
+	_tl_task_wake(in, _tl_task_waiters(task));
+}
+
+/** The bottom continuation of a spawned task, recording its return value. */
+static void _tl_task_finish_k(tl_interp *in, tl_object *args, tl_object *state) {
+	_tl_task_finish(in, state, in->true_, tl_first(args));
+}
+
+/** Handle the end of the current task, which has run out of continuations or raised an unrescued error.
+ *
+ * A spawned task is finished and another is switched to. The root task
+ * instead waits for the other runnable tasks by requeueing itself; it ends
+ * the whole computation (abandoning any other tasks) once it is the last, or
+ * if it ended in error. Returns nonzero if a task was switched to.
+ */
+static int _tl_task_exit(tl_interp *in) {
+	tl_object *task = in->task;
+	if(task == in->task_root) {
+		if(!tl_has_error(in) && in->tasks) {
+			_tl_task_save(in, task);
+			_tl_task_enqueue(in, task);
+			return _tl_task_next(in);
+		}
+		in->task = in->task_root = in->tasks = in->tasks_tail = TL_EMPTY_LIST;
+		return 0;
+	}
+	if(tl_has_error(in)) {
+		_tl_task_finish(in, task, in->false_, in->error);
+		tl_error_clear(in);
+	}
+	if(_tl_task_next(in)) return 1;
+	/* Only the root is left, blocked on something no task remains to do. */
+	_tl_task_load(in, in->task_root);
+	tl_error_set(in, tl_new_sym(in, "deadlock"));
+	return 1;
+}
+
+/** Spawn a task which calls `callable` with no arguments.
+ *
+ * Tasks are green threads: each has its own continuation, value, and rescue
+ * stacks, and `tl_apply_next` switches between them every
+ * tl_interp::task_quantum steps, or when one yields (`tl_yield`) or blocks.
+ * The first spawn turns the running computation into the "root" task (see
+ * tl_interp::task).
+ *
+ * The task is returned; it is a `TL_CFUNC_BYVAL` (see `tl_is_task`) which,
+ * when called, waits for the task to finish and returns its value, or raises
+ * its unrescued error.
+ */
+tl_object *tl_spawn(tl_interp *in, tl_object *callable) {
+	tl_object *task = _tl_new_task(in, TL_EMPTY_LIST, in->env);
+	tl_object *finish = tl_new_then(in, _tl_task_finish_k, task, "tl-task-finish");
+	_tl_task_ctx(task)->first = tl_new_pair(in,
+		tl_new_pair(in, tl_new_int(in, 0), tl_new_pair(in, callable, in->env)),
+		tl_new_pair(in, tl_new_pair(in, tl_new_int(in, 1), tl_new_pair(in, finish, in->env)), TL_EMPTY_LIST)
+	);
+	_tl_task_enqueue(in, task);
+	return task;
+}
+
+/** Let the other runnable tasks run before the current one continues. */
+void tl_yield(tl_interp *in) {
+	in->task_fuel = in->task_quantum;
+	if(!in->tasks) return;
+	_tl_task_save(in, in->task);
+	_tl_task_enqueue(in, in->task);
+	_tl_task_next(in);
+}
+
+/** C function behind a task (see `tl_spawn`), which joins it. */
+void tl_cfbv_join(tl_interp *in, tl_object *args, tl_object *state) {
+	tl_object *status = tl_first(state);
+	if(status && tl_is_pair(status)) {
+		if(tl_first(status) == in->false_) tl_error_set(in, tl_next(status));
+		tl_cfunc_return(in, tl_next(status));
+	}
+	if(tl_is_frozen(state)) {
+		tl_error_set(in, tl_new_pair(in, tl_new_sym(in, "join on frozen task"), state));
+		tl_cfunc_return(in, in->false_);
+	}
+	if(!_tl_task_park(in, tl_next(state), tl_new_then(in, tl_cfbv_join, state, "tl-task"))) {
+		tl_error_set(in, tl_new_sym(in, "deadlock"));
+		tl_cfunc_return(in, in->false_);
+	}
+}
+
+/** C function behind a channel (see `tl_new_chan`).
+ *
+ * With an argument, it is sent; without, one is received.
+ */
+void tl_cfbv_chan(tl_interp *in, tl_object *args, tl_object *state) {
+	tl_object *items = tl_next(state);
+	if(tl_is_frozen(state)) {
+		tl_error_set(in, tl_new_pair(in, tl_new_sym(in, "chan on frozen object"), state));
+		tl_cfunc_return(in, in->false_);
+	}
+	if(args) {
+		tl_object *cell = tl_new_pair(in, tl_first(args), TL_EMPTY_LIST);
+		if(tl_first(items)) {
+			tl_next(items)->next = cell;
+		} else {
+			items->first = cell;
+		}
+		items->next = cell;
+		_tl_task_wake(in, state);
+		tl_cfunc_return(in, tl_first(args));
+	}
+	if(tl_first(items)) {
+		tl_object *val = tl_first(tl_first(items));
+		items->first = tl_next(tl_first(items));
+		if(!tl_first(items)) items->next = TL_EMPTY_LIST;
+		tl_cfunc_return(in, val);
+	}
+	if(!_tl_task_park(in, state, tl_new_then(in, tl_cfbv_chan, state, "tl-chan"))) {
+		tl_error_set(in, tl_new_sym(in, "deadlock"));
+		tl_cfunc_return(in, in->false_);
+	}
+}
+
+/** Create a channel, through which tasks (see `tl_spawn`) can pass values.
+ *
+ * This is a `TL_CFUNC_BYVAL` (see `tl_is_chan`); calling it with a value
+ * queues that value (without bound, so sending never blocks), and calling it
+ * without one removes the oldest value, blocking the calling task until one
+ * is sent if need be. Its state is `(receivers . (items . last-item))`.
+ */
+tl_object *tl_new_chan(tl_interp *in) {
+	tl_object *chan = _tl_new_cfunc_byval(in, tl_cfbv_chan, "tl-chan");
+	chan->state = tl_new_pair(in, TL_EMPTY_LIST, tl_new_pair(in, TL_EMPTY_LIST, TL_EMPTY_LIST));
+	return chan;
+}
+
 /** Run the next step of the interpreter.
  *
  * This is the top-level entry for running a single step of a TinyLISP
@@ -253,7 +819,7 @@ void _tl_apply_next_body_callable_k(tl_interp *in, tl_object *args, tl_object *c
  * tl_interp::readf.
  */
 int tl_apply_next(tl_interp *in) {
-	tl_object *cont = tl_first(in->conts);
+	tl_object *cont;
 	long len;
 	tl_object *callex, *env, *args = TL_EMPTY_LIST;
 	int res;
@@ -264,7 +830,7 @@ int tl_apply_next(tl_interp *in) {
 	*/
 	if(tl_has_error(in)) {
 		tl_object *rescue = tl_rescue_peek(in);
-		if(!rescue) return TL_RESULT_DONE;
+		if(!rescue) return in->task && _tl_task_exit(in) ? TL_RESULT_AGAIN : TL_RESULT_DONE;
 		tl_rescue_drop(in);
 		/* Trampoline into the rescue continuation--we could do this directly,
 		 * but why reinvent the wheel? */
@@ -273,8 +839,10 @@ int tl_apply_next(tl_interp *in) {
 		tl_error_clear(in);
 		return TL_RESULT_AGAIN;
 	}
+	if(in->tasks && !--in->task_fuel) tl_yield(in);
+	cont = tl_first(in->conts);
 	in->current = cont;
-	if(!cont) return TL_RESULT_DONE;
+	if(!cont) return in->task && _tl_task_exit(in) ? TL_RESULT_AGAIN : TL_RESULT_DONE;
 	in->conts = tl_next(in->conts);
 	assert(tl_is_int(tl_first(cont)));
 	len = tl_first(cont)->ival;
@@ -290,7 +858,26 @@ int tl_apply_next(tl_interp *in) {
 		return TL_RESULT_AGAIN;
 	}
 	if(len == TL_APPLY_DROP_RESCUE) {
+		tl_object *rescue = tl_rescue_peek(in);
 		tl_rescue_drop(in);
+		if(tl_is_cfunc_byval(rescue) && rescue->cfunc == _tl_ec_invoke) _tl_ec_invalidate(in, rescue->state);
+		return TL_RESULT_AGAIN;
+	}
+	if(len == TL_APPLY_PROMPT) return TL_RESULT_AGAIN;
+	if(len == TL_APPLY_EXIT_EC) {
+		_tl_ec_invalidate(in, callex);
+		return TL_RESULT_AGAIN;
+	}
+	if(len == TL_APPLY_IF) {
+		tl_values_pop_into(in, args);
+		in->env = env;
+		tl_push_eval(in, tl_first(tl_first(_unboolify(in, args) ? tl_next(callex) : callex)), env);
+		return TL_RESULT_AGAIN;
+	}
+	if(len == TL_APPLY_DEFINE || len == TL_APPLY_SET) {
+		tl_values_pop_into(in, args);
+		in->env = env;
+		_tl_apply_bind(in, len == TL_APPLY_DEFINE, callex, args);
 		return TL_RESULT_AGAIN;
 	}
 	if(len == TL_APPLY_GETCHAR) {
@@ -298,6 +885,9 @@ int tl_apply_next(tl_interp *in) {
 			tl_values_push(in, tl_new_int(in, in->putback));
 			in->is_putback = 0;
 			return TL_RESULT_AGAIN;
+		} else if(in->input_pos < in->input_len) {
+			tl_values_push(in, tl_new_int(in, (unsigned char)in->input_buf[in->input_pos++]));
+			return TL_RESULT_AGAIN;
 		} else {
 			return TL_RESULT_GETCHAR;
 		}
@@ -354,11 +944,17 @@ int tl_apply_next(tl_interp *in) {
 		tl_error_set(in, tl_new_pair(in, tl_new_sym(in, "call non-callable"), callex));
 		return TL_RESULT_AGAIN;
 	}
+	in->env = env;
+	if(callex->kind == TL_CFUNC && _tl_apply_intrinsic(in, callex, len, env)) {
+		return TL_RESULT_AGAIN;
+	}
+	if(callex->kind == TL_CFUNC_BYVAL && callex->ent && _tl_apply_argv_values(in, callex, len)) {
+		return TL_RESULT_AGAIN;
+	}
 	for(int i = 0; i < len; i++) {
 		args = tl_new_pair(in, tl_first(in->values), args);
 		in->values = tl_next(in->values);
 	}
-	in->env = env;
 	tl_object *new_args = TL_EMPTY_LIST;
 	switch(callex->kind) {
 		case TL_FUNC:
@@ -428,26 +1024,48 @@ void _tl_getc_and_then(tl_interp *in, tl_object *state, void (*then)(tl_interp *
 	tl_push_apply(in, TL_APPLY_GETCHAR, TL_EMPTY_LIST, TL_EMPTY_LIST);
 }
 
+void _tl_eval_all_args_k(tl_interp *, tl_object *, tl_object *);
+
+/** Evaluate the remaining `args` onto the reversed `stack` of values.
+ *
+ * Direct values and immediately resolvable syntaxes (see
+ * `_tl_eval_immediate`) are consumed in a loop without touching the
+ * continuation stack; only an application suspends, resuming in
+ * `_tl_eval_all_args_k`. Returns nonzero if all arguments were resolved
+ * immediately, in which case the caller is responsible for delivering `stack`
+ * to the continuation.
+ */
+static int _tl_eval_all_args_loop(tl_interp *in, tl_object *args, tl_object **stack, tl_object *then) {
+	tl_object *value;
+	for(; args; args = tl_next(args)) {
+		tl_object *arg = tl_first(args);
+		if(tl_next(arg) != in->true_) {
+			*stack = tl_new_pair(in, tl_first(arg), *stack);
+			continue;
+		}
+		if(_tl_eval_immediate(in, tl_first(arg), &value)) {
+			if(tl_has_error(in)) return 0;
+			*stack = tl_new_pair(in, value, *stack);
+			continue;
+		}
+		tl_eval_and_then(in, tl_first(arg), tl_new_pair(in,
+			tl_new_pair(in,
+				tl_new_pair(in, tl_next(args), TL_EMPTY_LIST),
+				*stack
+			),
+			then
+		), _tl_eval_all_args_k);
+		return 0;
+	}
+	return 1;
+}
+
 /** Continuation for `_tl_eval_all_args` (see). */
 void _tl_eval_all_args_k(tl_interp *in, tl_object *result, tl_object *state) {
 	tl_object *args = tl_first(tl_first(tl_first(state)));
 	tl_object *stack = tl_new_pair(in, tl_first(result), tl_next(tl_first(state)));
 	tl_object *then = tl_next(state);
-	tl_object *new_state = tl_new_pair(in,
-		tl_new_pair(in,
-			tl_new_pair(in, tl_next(args), TL_EMPTY_LIST),
-			stack
-		),
-		then
-	);
-	if(args) {
-		if(tl_next(tl_first(args)) == in->true_) {
-			tl_eval_and_then(in, tl_first(tl_first(args)), new_state, _tl_eval_all_args_k);
-		} else {
-			tl_values_push(in, tl_first(tl_first(args)));
-			tl_push_apply(in, 1, tl_new_then(in, _tl_eval_all_args_k, new_state, "_tl_apply_all_args_k<indirect>"), in->env);
-		}
-	} else {
+	if(_tl_eval_all_args_loop(in, args, &stack, then)) {
 		for(tl_list_iter(tl_list_rvs(in, stack), elem)) {
 			tl_values_push(in, elem);
 		}
@@ -464,26 +1082,37 @@ void _tl_eval_all_args_k(tl_interp *in, tl_object *result, tl_object *state) {
  * is direct (id est, already evaluated) and true if the value is syntactic
  * (needs to be evaluated). The continuation's arguments consist only of the
  * values, once each syntactic one has been directly evaluated.
+ *
+ * If every argument is direct, or a syntax that can be resolved without an
+ * application (an integer, callable, or variable), `then` is called directly
+ * before this returns, and no C continuation is allocated at all; thus, this
+ * must be the last thing a caller does. Otherwise, evaluation proceeds one
+ * application at a time through `_tl_eval_all_args_k`.
  */
 void _tl_eval_all_args(tl_interp *in, tl_object *args, tl_object *state, void (*then)(tl_interp *, tl_object *, tl_object *), const char *name) {
-	tl_object *tobj = tl_new_then(in, then, state, name);
-	if(args) {
-		tl_object *state = tl_new_pair(in,
-			tl_new_pair(in, 
-				tl_new_pair(in, tl_next(args), TL_EMPTY_LIST),
-				TL_EMPTY_LIST
-			),
-			tobj
-		);
-		if(tl_next(tl_first(args)) == in->true_) {
-			tl_eval_and_then(in, tl_first(tl_first(args)), state, _tl_eval_all_args_k);
+	tl_object *stack = TL_EMPTY_LIST;
+	tl_object *rest = args, *value;
+
+	/* Fast path: resolve the leading immediate arguments, deferring creation
+	 * of the continuation until one is actually needed. */
+	for(; rest; rest = tl_next(rest)) {
+		tl_object *arg = tl_first(rest);
+		if(tl_next(arg) != in->true_) {
+			value = tl_first(arg);
+		} else if(_tl_eval_immediate(in, tl_first(arg), &value)) {
+			if(tl_has_error(in)) return;
 		} else {
-			tl_values_push(in, tl_first(tl_first(args)));
-			tl_push_apply(in, 1, tl_new_then(in, _tl_eval_all_args_k, state, "_tl_apply_all_args_k<direct>"), in->env);
+			break;
 		}
-	} else {
-		tl_push_apply(in, 0, tl_new_then(in, then, state, name), in->env);
+		stack = tl_new_pair(in, value, stack);
 	}
+	if(!rest) {
+		then(in, tl_list_rvs(in, stack), state);
+		return;
+	}
+
+	/* rest begins with an application, so this always suspends */
+	_tl_eval_all_args_loop(in, rest, &stack, tl_new_then(in, then, state, name));
 }
 
 /** Runs an interpreter with one or more pushed evaluations until all evaulation is finished or an error occurs.
@@ -509,3 +1138,33 @@ void tl_run_until_done(tl_interp *in) {
 		}
 	}
 }
+
+/** Run the interpreter for a bounded amount of work.
+ *
+ * This calls `tl_apply_next` until the computation finishes or needs input,
+ * for at most `steps` steps (unless 0), and until tl_interp::clockf passes
+ * `deadline_ns` (unless 0; see ::TL_RUN_CLOCK_INTERVAL for its precision). It
+ * returns `TL_RESULT_DONE` or `TL_RESULT_GETCHAR` as `tl_apply_next` would,
+ * or `TL_RESULT_AGAIN` if it ran out of budget, and stores the number of
+ * steps taken in `*ran` if that isn't NULL.
+ *
+ * Unlike `tl_run_until_done`, `TL_RESULT_GETCHAR` is left to the caller, so
+ * this suits hosts that have to return to an event loop, or share their time
+ * between several interpreters (or computations).
+ */
+int tl_run_for(tl_interp *in, size_t steps, unsigned long long deadline_ns, size_t *ran) {
+	size_t n = 0, next_clock = TL_RUN_CLOCK_INTERVAL;
+	int res = TL_RESULT_AGAIN;
+	if(!in->clockf) deadline_ns = 0;
+	while(!steps || n < steps) {
+		res = tl_apply_next(in);
+		n++;
+		if(res != TL_RESULT_AGAIN) break;
+		if(deadline_ns && n == next_clock) {
+			if(in->clockf(in) >= deadline_ns) break;
+			next_clock += TL_RUN_CLOCK_INTERVAL;
+		}
+	}
+	if(ran) *ran = n;
+	return res;
+}
@@ -0,0 +1,499 @@
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#if defined(UNIX) && !defined(NO_MMAP)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "tinylisp.h"
+
+/* A heap image is a native-endian file, only portable between builds with the
+ * same word size and tl_object layout (which the header records):
+ *
+ * - the header below;
+ * - `nobjects` tl_objects, in which every pointer to another object is its
+ *   index plus one (zero for NULL), and a symbol's tl_object::nm is the index
+ *   of its name plus one;
+ * - `nnames` offsets into the strings, one per distinct symbol name;
+ * - `nautoloads` pairs of a name's index plus one and a string's offset plus
+ *   one, for the definitions not yet autoloaded (see ::tl_autoload), whose
+ *   encoded forms are kept as strings;
+ * - the strings, each a size_t length, the bytes, and a NUL, padded to a
+ *   size_t boundary; an object's tl_object::name is such an offset plus one.
+ *
+ * A C function keeps its name, and is saved as resolvable (tl_object::ent is
+ * nonzero) if that name is bound to it in the saving interpreter's top-level
+ * environment; anything else (like the C continuations inside a captured
+ * continuation) can't be restored, and raises an error if called.
+ */
+
+#define TL_IMAGE_MAGIC "TLIMAGE"
+#define TL_IMAGE_VERSION 2
+
+struct tl_image_header {
+	char magic[8];
+	size_t version;
+	size_t object_size;
+	size_t nobjects;
+	size_t nnames;
+	size_t nautoloads;
+	size_t strings_len;
+	size_t true_, false_, top_env, prefixes;
+	tl_tag next_tag;
+};
+
+#define _tl_image_align(n) (((n) + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1))
+#define _tl_image_objects_off _tl_image_align(sizeof(struct tl_image_header))
+
+/** The state of ::tl_image_save . */
+struct tl_image_writer {
+	tl_ptrmap objmap, namemap;
+	tl_object **objs;
+	size_t nobjs, szobjs;
+	size_t *names;
+	size_t nnames, sznames;
+	char *strings;
+	size_t strings_len, sz_strings;
+	int bad;
+};
+
+static size_t _tl_image_ref(tl_interp *in, struct tl_image_writer *w, tl_object *obj) {
+	size_t *slot;
+	if(!obj) return 0;
+	if(obj->kind == TL_PTR) {
+		w->bad = 1;
+		return 0;
+	}
+	slot = tl_ptrmap_slot(in, &w->objmap, obj);
+	if(!*slot) {
+		if(w->nobjs >= w->szobjs) {
+			w->szobjs = (w->szobjs << 1) | 255;
+			w->objs = tl_alloc_realloc(in, w->objs, w->szobjs * sizeof(*w->objs));
+			assert(w->objs);
+		}
+		w->objs[w->nobjs++] = obj;
+		*slot = w->nobjs;
+	}
+	return *slot;
+}
+
+static size_t _tl_image_string(tl_interp *in, struct tl_image_writer *w, const char *data, size_t len) {
+	size_t off = w->strings_len, need = _tl_image_align(sizeof(size_t) + len + 1);
+	if(off + need > w->sz_strings) {
+		while(off + need > w->sz_strings) w->sz_strings = (w->sz_strings << 1) | 4095;
+		w->strings = tl_alloc_realloc(in, w->strings, w->sz_strings);
+		assert(w->strings);
+	}
+	memset(w->strings + off, 0, need);
+	memcpy(w->strings + off, &len, sizeof(size_t));
+	memcpy(w->strings + off + sizeof(size_t), data, len);
+	w->strings_len += need;
+	return off + 1;
+}
+
+static size_t _tl_image_name(tl_interp *in, struct tl_image_writer *w, tl_name *nm) {
+	size_t *slot = tl_ptrmap_slot(in, &w->namemap, nm);
+	if(!*slot) {
+		if(w->nnames >= w->sznames) {
+			w->sznames = (w->sznames << 1) | 255;
+			w->names = tl_alloc_realloc(in, w->names, w->sznames * sizeof(*w->names));
+			assert(w->names);
+		}
+		w->names[w->nnames++] = _tl_image_string(in, w, nm->here.data, nm->here.len) - 1;
+		*slot = w->nnames;
+	}
+	return *slot;
+}
+
+/* Whether a C function is bound to its own name at top level. */
+static int _tl_image_resolvable(tl_interp *in, tl_object *obj) {
+	size_t len;
+	if(obj->kind == TL_THEN || !obj->name) return 0;
+	len = strlen(obj->name);
+	for(tl_list_iter(in->top_env, frame)) {
+		for(tl_list_iter(frame, kv)) {
+			tl_object *key = tl_first(kv);
+			if(key && tl_is_sym(key) && key->nm->here.len == len && !memcmp(key->nm->here.data, obj->name, len)) {
+				return tl_next(kv) == obj;
+			}
+		}
+	}
+	return 0;
+}
+
+#define _tl_image_enc(n) ((void *)(size_t)(n))
+
+/** Save the interpreter's top-level state as a heap image.
+ *
+ * This writes everything reachable from tl_interp::top_env and
+ * tl_interp::prefixes (along with the symbols they use) to `path`, so that
+ * ::tl_image_load can restore it without evaluating anything. This is usually
+ * done once `std.tl` (and the application's own library) have been loaded.
+ * C functions are saved by name, and must be rebound on load; see there.
+ * Definitions not yet autoloaded are saved as they are, and are autoloaded
+ * from the image when first used.
+ *
+ * Pointer objects (::TL_PTR) can't be saved; returns 0 if there were any, or
+ * if the file couldn't be written, and nonzero on success.
+ */
+int tl_image_save(tl_interp *in, const char *path) {
+	struct tl_image_writer w;
+	struct tl_image_header hdr;
+	tl_object *out = NULL;
+	size_t i, pad, szout = 0, *autoloads = NULL, nautoloads = 0;
+	FILE *f;
+	int ok = 0;
+
+	memset(&w, 0, sizeof(w));
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, TL_IMAGE_MAGIC, sizeof(TL_IMAGE_MAGIC));
+	hdr.version = TL_IMAGE_VERSION;
+	hdr.object_size = sizeof(tl_object);
+	hdr.true_ = _tl_image_ref(in, &w, in->true_);
+	hdr.false_ = _tl_image_ref(in, &w, in->false_);
+	hdr.top_env = _tl_image_ref(in, &w, in->top_env);
+	hdr.prefixes = _tl_image_ref(in, &w, in->prefixes);
+	hdr.next_tag = in->next_tag;
+
+	/* objs doubles as the queue of objects whose fields are yet to be visited */
+	for(i = 0; i < w.nobjs && !w.bad; i++) {
+		tl_object *obj = w.objs[i];
+		tl_object enc = *obj;
+		switch(obj->kind) {
+			case TL_INT:
+				break;
+
+			case TL_SYM:
+				enc.nm = _tl_image_enc(_tl_image_name(in, &w, obj->nm));
+				break;
+
+			case TL_PAIR:
+				enc.first = _tl_image_enc(_tl_image_ref(in, &w, obj->first));
+				enc.next = _tl_image_enc(_tl_image_ref(in, &w, obj->next));
+				break;
+
+			case TL_CFUNC:
+			case TL_CFUNC_BYVAL:
+			case TL_THEN:
+				enc.cfunc = NULL;
+				enc.ent = _tl_image_enc(_tl_image_resolvable(in, obj));
+				enc.state = _tl_image_enc(_tl_image_ref(in, &w, obj->state));
+				enc.name = obj->name ? _tl_image_enc(_tl_image_string(in, &w, obj->name, strlen(obj->name))) : NULL;
+				break;
+
+			case TL_FUNC:
+			case TL_MACRO:
+				enc.args = _tl_image_enc(_tl_image_ref(in, &w, obj->args));
+				enc.body = _tl_image_enc(_tl_image_ref(in, &w, obj->body));
+				enc.env = _tl_image_enc(_tl_image_ref(in, &w, obj->env));
+				enc.envn = _tl_image_enc(_tl_image_ref(in, &w, obj->envn));
+				break;
+
+			case TL_CONT:
+				enc.ret_env = _tl_image_enc(_tl_image_ref(in, &w, obj->ret_env));
+				enc.ret_conts = _tl_image_enc(_tl_image_ref(in, &w, obj->ret_conts));
+				enc.ret_values = _tl_image_enc(_tl_image_ref(in, &w, obj->ret_values));
+				break;
+
+			default:
+				w.bad = 1;
+				break;
+		}
+		/* The allocation links become a self-reference; see tl_image_load */
+		enc.next_alloc = NULL;
+		enc.prev_alloc = _tl_image_enc(i + 1);
+#ifdef NO_GC_PACK
+		enc.flags = 0;
+#endif
+		if(i >= szout) {
+			szout = w.szobjs;
+			out = tl_alloc_realloc(in, out, szout * sizeof(tl_object));
+			assert(out);
+		}
+		out[i] = enc;
+	}
+	if(in->nautoloads) {
+		autoloads = tl_alloc_malloc(in, 2 * in->nautoloads * sizeof(*autoloads));
+		assert(autoloads);
+	}
+	for(i = 0; i < in->autoload.cap; i++) {
+		size_t idx = in->autoload.vals[i];
+		if(in->autoload.keys[i] && idx) {
+			autoloads[2 * nautoloads] = _tl_image_name(in, &w, (tl_name *)in->autoload.keys[i]);
+			autoloads[2 * nautoloads + 1] = _tl_image_string(in, &w, in->autoloads[idx - 1].data, in->autoloads[idx - 1].len);
+			nautoloads++;
+		}
+	}
+	hdr.nobjects = w.nobjs;
+	hdr.nnames = w.nnames;
+	hdr.nautoloads = nautoloads;
+	hdr.strings_len = w.strings_len;
+
+	if(!w.bad && (f = fopen(path, "wb"))) {
+		static const char zeros[sizeof(size_t)];
+		pad = _tl_image_objects_off - sizeof(hdr);
+		ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1
+			&& fwrite(zeros, 1, pad, f) == pad
+			&& fwrite(out, sizeof(tl_object), w.nobjs, f) == w.nobjs
+			&& fwrite(w.names, sizeof(size_t), w.nnames, f) == w.nnames
+			&& fwrite(autoloads, sizeof(size_t), 2 * nautoloads, f) == 2 * nautoloads
+			&& fwrite(w.strings, 1, w.strings_len, f) == w.strings_len;
+		if(fclose(f)) ok = 0;
+	}
+
+	tl_alloc_free(in, out);
+	tl_alloc_free(in, autoloads);
+	tl_alloc_free(in, w.objs);
+	tl_alloc_free(in, w.names);
+	tl_alloc_free(in, w.strings);
+	tl_ptrmap_free(in, &w.objmap);
+	tl_ptrmap_free(in, &w.namemap);
+	return ok;
+}
+
+/* Stands in for a C function that couldn't be rebound. */
+static void _tl_image_unresolved(tl_interp *in, tl_object *args, tl_object *_) {
+	tl_error_set(in, tl_new_pair(in, tl_new_sym(in, "unresolved builtin"), args));
+	tl_cfunc_return(in, in->false_);
+}
+
+/* Map the file; returns NULL on failure. */
+static void *_tl_image_map_file(tl_interp *in, const char *path, size_t *len) {
+#if defined(UNIX) && !defined(NO_MMAP)
+	struct stat st;
+	void *data;
+	int fd = open(path, O_RDONLY);
+	if(fd < 0) return NULL;
+	if(fstat(fd, &st) || st.st_size < (off_t)_tl_image_objects_off) {
+		close(fd);
+		return NULL;
+	}
+	*len = st.st_size;
+	/* Private, so that relocating the pointers doesn't write the file */
+	data = mmap(NULL, *len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	return data == MAP_FAILED ? NULL : data;
+#else
+	char *data = NULL, *grown;
+	size_t sz = 0, got;
+	FILE *f = fopen(path, "rb");
+	if(!f) return NULL;
+	*len = 0;
+	do {
+		if(*len == sz) {
+			sz = (sz << 1) | 65535;
+			if(!(grown = tl_alloc_realloc(in, data, sz))) {
+				tl_alloc_free(in, data);
+				fclose(f);
+				return NULL;
+			}
+			data = grown;
+		}
+		got = fread(data + *len, 1, sz - *len, f);
+		*len += got;
+	} while(got);
+	fclose(f);
+	if(*len < _tl_image_objects_off) {
+		tl_alloc_free(in, data);
+		return NULL;
+	}
+	return data;
+#endif
+}
+
+static void _tl_image_unmap(tl_interp *in, void *data, size_t len) {
+#if defined(UNIX) && !defined(NO_MMAP)
+	munmap(data, len);
+#else
+	tl_alloc_free(in, data);
+#endif
+}
+
+/** Release the heap image of an interpreter, if any; see ::tl_interp_cleanup . */
+void tl_image_release(tl_interp *in) {
+	if(in->image) _tl_image_unmap(in, in->image, in->image_len);
+	in->image = NULL;
+	in->image_len = 0;
+}
+
+/** Replace an interpreter's top-level state with a heap image.
+ *
+ * `in` must be initialized (with ::tl_interp_init or the like) and idle. The
+ * image written by ::tl_image_save at `path` is mapped into memory, its
+ * pointers are relocated in one pass, and its objects then serve as a frozen
+ * heap (see ::tl_interp_freeze), under a fresh top frame, in place of
+ * tl_interp::top_env ; this is much faster than evaluating the library it
+ * came from. As with a frozen heap, other interpreters can be started from
+ * this one with ::tl_interp_init_base .
+ *
+ * Each saved C function is rebound to the function bound to its name in
+ * `in`'s top-level environment as it was before loading, which has all of
+ * the builtins; one that isn't found raises an error when called. Anything
+ * the application adds with ::tl_interp_load_funcs (as ::TL_LOAD_FUNCS does)
+ * should therefore be added after loading, which shadows the saved ones.
+ *
+ * Returns nonzero on success. On failure (when the file is missing,
+ * truncated, or from an incompatible build), `in` is unchanged, except that it
+ * may have interned some more symbols.
+ */
+int tl_image_load(tl_interp *in, const char *path) {
+	struct tl_image_header *hdr;
+	tl_object *objs, *obj, *old_top = in->top_env;
+	size_t len, i, *names_off, *autoloads;
+	tl_name **names = NULL;
+	char *strings, *data;
+	int bad = 0;
+
+	if(in->frozen_ns.root || in->conts || in->values) return 0;
+	if(!(data = _tl_image_map_file(in, path, &len))) return 0;
+	hdr = (struct tl_image_header *)data;
+	objs = (tl_object *)(data + _tl_image_objects_off);
+	names_off = (size_t *)(objs + hdr->nobjects);
+	autoloads = names_off + hdr->nnames;
+	strings = (char *)(autoloads + 2 * hdr->nautoloads);
+	if(memcmp(hdr->magic, TL_IMAGE_MAGIC, sizeof(TL_IMAGE_MAGIC)) || hdr->version != TL_IMAGE_VERSION || hdr->object_size != sizeof(tl_object)
+			|| hdr->nobjects > (len - _tl_image_objects_off) / sizeof(tl_object)
+			|| hdr->nnames > (len - _tl_image_objects_off - hdr->nobjects * sizeof(tl_object)) / sizeof(size_t)
+			|| hdr->nautoloads > (len - _tl_image_objects_off - hdr->nobjects * sizeof(tl_object) - hdr->nnames * sizeof(size_t)) / (2 * sizeof(size_t))
+			|| hdr->strings_len != (size_t)(data + len - strings)) {
+		goto fail;
+	}
+
+/* Decode a reference, setting bad if it is out of range. */
+#define _tl_image_obj(ref) ((size_t)(ref) > hdr->nobjects ? (bad = 1, (tl_object *)NULL) : (size_t)(ref) ? objs + ((size_t)(ref) - 1) : NULL)
+
+	if(hdr->nnames) {
+		names = tl_alloc_malloc(in, hdr->nnames * sizeof(*names));
+		assert(names);
+	}
+	for(i = 0; i < hdr->nnames; i++) {
+		tl_buffer buf;
+		if(names_off[i] > hdr->strings_len - sizeof(size_t)) goto fail;
+		memcpy(&buf.len, strings + names_off[i], sizeof(size_t));
+		if(buf.len > hdr->strings_len - names_off[i] - sizeof(size_t)) goto fail;
+		buf.data = strings + names_off[i] + sizeof(size_t);
+		names[i] = tl_ns_resolve(in, &in->ns, buf);
+	}
+	for(i = 0; i < hdr->nautoloads; i++) {
+		size_t nm = autoloads[2 * i], off = autoloads[2 * i + 1] - 1, alen;
+		if(!nm || nm > hdr->nnames || off > hdr->strings_len - sizeof(size_t)) goto fail;
+		memcpy(&alen, strings + off, sizeof(size_t));
+		if(alen > hdr->strings_len - off - sizeof(size_t)) goto fail;
+	}
+
+	for(i = 0; i < hdr->nobjects; i++) {
+		obj = objs + i;
+		switch(obj->kind) {
+			case TL_INT:
+				break;
+
+			case TL_SYM:
+				if(!(size_t)obj->nm || (size_t)obj->nm > hdr->nnames) goto fail;
+				obj->nm = names[(size_t)obj->nm - 1];
+				break;
+
+			case TL_PAIR:
+				obj->first = _tl_image_obj(obj->first);
+				obj->next = _tl_image_obj(obj->next);
+				break;
+
+			case TL_CFUNC:
+			case TL_CFUNC_BYVAL:
+			case TL_THEN: {
+				int resolvable = obj->ent != NULL;
+				if(obj->name) {
+					size_t off = (size_t)obj->name - 1, nlen;
+					if(off > hdr->strings_len - sizeof(size_t)) goto fail;
+					memcpy(&nlen, strings + off, sizeof(size_t));
+					if(nlen >= hdr->strings_len - off - sizeof(size_t)) goto fail;
+					obj->name = strings + off + sizeof(size_t);
+				}
+				obj->state = _tl_image_obj(obj->state);
+				obj->cfunc = _tl_image_unresolved;
+				obj->ent = NULL;
+				if(resolvable && obj->name) {
+					tl_name *nm = tl_ns_find(&in->ns, (tl_buffer){obj->name, strlen(obj->name)});
+					for(tl_list_iter(old_top, frame)) {
+						for(tl_list_iter(frame, kv)) {
+							tl_object *key = tl_first(kv), *val = tl_next(kv);
+							if(key && tl_is_sym(key) && key->nm == nm) {
+								if(val && val->kind == obj->kind) {
+									obj->cfunc = val->cfunc;
+									obj->ent = val->ent;
+								}
+								goto resolved;
+							}
+						}
+					}
+				resolved:;
+				}
+				break;
+			}
+
+			case TL_FUNC:
+			case TL_MACRO:
+				obj->args = _tl_image_obj(obj->args);
+				obj->body = _tl_image_obj(obj->body);
+				obj->env = _tl_image_obj(obj->env);
+				obj->envn = _tl_image_obj(obj->envn);
+				break;
+
+			case TL_CONT:
+				obj->ret_env = _tl_image_obj(obj->ret_env);
+				obj->ret_conts = _tl_image_obj(obj->ret_conts);
+				obj->ret_values = _tl_image_obj(obj->ret_values);
+				break;
+
+			default:
+				goto fail;
+		}
+		if((size_t)obj->prev_alloc != i + 1) goto fail;
+		obj->prev_alloc = obj;
+		tl_mark(obj);
+		if(bad) goto fail;
+	}
+	if(!hdr->true_ || !hdr->false_ || !hdr->top_env) goto fail;
+	in->true_ = _tl_image_obj(hdr->true_);
+	in->false_ = _tl_image_obj(hdr->false_);
+	in->prefixes = _tl_image_obj(hdr->prefixes);
+	in->top_env = in->env = tl_new_pair(in, TL_EMPTY_LIST, _tl_image_obj(hdr->top_env));
+	if(in->next_tag < hdr->next_tag) in->next_tag = hdr->next_tag;
+	/* The encoded forms stay in the image, which lives as long as `in` */
+	for(i = 0; i < hdr->nautoloads; i++) {
+		size_t off = autoloads[2 * i + 1] - 1, alen;
+		memcpy(&alen, strings + off, sizeof(size_t));
+		tl_autoload(in, names[autoloads[2 * i] - 1], strings + off + sizeof(size_t), alen);
+	}
+#undef _tl_image_obj
+	tl_alloc_free(in, names);
+
+	/* As in tl_interp_freeze */
+	in->frozen_ns = in->ns;
+	tl_ns_init(in, &in->ns);
+	in->ns.base = &in->frozen_ns;
+	in->image = data;
+	in->image_len = len;
+	tl_gc(in);
+	return 1;
+
+fail:
+	tl_alloc_free(in, names);
+	_tl_image_unmap(in, data, len);
+	return 0;
+}
+
+TL_CFBV(image_save, "image-save") {
+	char *path = tl_sym_to_cstr(in, tl_first(args));
+	int ok;
+	if(!path) {
+		tl_error_set(in, tl_new_pair(in, tl_new_sym(in, "image-save on non-sym"), tl_first(args)));
+		tl_cfunc_return(in, in->false_);
+	}
+	ok = tl_image_save(in, path);
+	tl_alloc_free(in, path);
+	tl_cfunc_return(in, ok ? in->true_ : in->false_);
+}
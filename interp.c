@@ -7,9 +7,21 @@ TL_DECLARE_INIT_ENTS;
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <assert.h>
 static int _readf(tl_interp *in) { return getchar(); }
 static void _writef(tl_interp *in, const char c) { putchar(c); }
 static int _modloadf(tl_interp *in, const char *fn) { return 0; }
+#if defined(UNIX) && !defined(NO_CLOCK)
+#include <time.h>
+static unsigned long long _clockf(tl_interp *in) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+#else
+#define _clockf NULL
+#endif
 static void *_reallocf(tl_interp *in, void *ptr, size_t s) {
 	/* Valgrind is unhappy unless this actually uses free, so we'll force this
 	 * to occur.
@@ -56,10 +68,14 @@ void tl_interp_init(tl_interp *in) {
  * See tl_interp_init() for other details.
  */
 
-void tl_interp_init_alloc(tl_interp *in, void *(*reallocf)(tl_interp *, void *, size_t)) {
+/* The initialization common to tl_interp_init_alloc() and tl_interp_init_base(). */
+static void _tl_interp_init_state(tl_interp *in, void *(*reallocf)(tl_interp *, void *, size_t)) {
 	in->reallocf = reallocf;
 	in->readf = _readf;
 	in->writef = _writef;
+	in->readbuf = NULL;
+	in->writebuf = NULL;
+	in->clockf = _clockf;
 #ifdef CONFIG_MODULES
 	in->modloadf = _modloadf;
 #endif
@@ -68,22 +84,48 @@ void tl_interp_init_alloc(tl_interp *in, void *(*reallocf)(tl_interp *, void *,
 	in->top_alloc = in->free_alloc = NULL;
 	in->oballoc_batch = TL_DEFAULT_OBALLOC_BATCH;
 
-	in->true_ = tl_new_sym(in, "tl-#t");
-	in->false_ = tl_new_sym(in, "tl-#f");
 	in->error = NULL;
 	in->prefixes = TL_EMPTY_LIST;
 	in->current = TL_EMPTY_LIST;
 	in->conts = TL_EMPTY_LIST;
 	in->values = TL_EMPTY_LIST;
 	in->rescue = TL_EMPTY_LIST;
+	in->task = in->task_root = TL_EMPTY_LIST;
+	in->tasks = in->tasks_tail = TL_EMPTY_LIST;
+	in->task_quantum = TL_DEFAULT_TASK_QUANTUM;
+	in->task_fuel = in->task_quantum;
 	in->gc_events = TL_DEFAULT_GC_EVENTS;
 	in->ctr_events = 0;
 	in->putback = 0;
 	in->is_putback = 0;
+	in->input_buf = NULL;
+	in->input_len = in->input_pos = 0;
 	in->read_buffer = NULL;
+	in->output_buf = NULL;
+	in->output_len = 0;
+	in->flush_lines = 0;
 	in->disp_sep = '\t';
 	in->disp_indent = '\0';
+	memset(&in->print_opts, 0, sizeof(in->print_opts));
+	in->loop_name = NULL;
 	in->next_tag = 1;
+	in->mod_state = NULL;
+	in->mod_state_len = 0;
+	in->frozen = NULL;
+	in->frozen_ns.root = NULL;
+	in->frozen_ns.base = NULL;
+	in->image = NULL;
+	in->image_len = 0;
+	memset(&in->autoload, 0, sizeof(in->autoload));
+	in->autoloads = NULL;
+	in->nautoloads = in->szautoloads = 0;
+}
+
+void tl_interp_init_alloc(tl_interp *in, void *(*reallocf)(tl_interp *, void *, size_t)) {
+	_tl_interp_init_state(in, reallocf);
+
+	in->true_ = tl_new_sym(in, "tl-#t");
+	in->false_ = tl_new_sym(in, "tl-#f");
 
 	in->top_env = TL_EMPTY_LIST;
 
@@ -100,6 +142,46 @@ void tl_interp_init_alloc(tl_interp *in, void *(*reallocf)(tl_interp *, void *,
 	in->env = in->top_env;
 }
 
+/** Initialize a TinyLISP interpreter atop another's frozen heap.
+ *
+ * `base` must have been frozen with ::tl_interp_freeze (or loaded with
+ * ::tl_image_load ); the new interpreter
+ * starts with its environment (under a fresh top frame of its own), symbols,
+ * prefixes, module state, and definitions to autoload (each loaded again by
+ * every such interpreter that uses it), as they were at that time, without copying or
+ * evaluating anything. It uses the same allocator, but otherwise the defaults
+ * of tl_interp_init(), and it can run on a different thread than `base` or
+ * its other children, since none of them change the frozen objects.
+ *
+ * `base` must outlive it: clean this interpreter up first.
+ */
+void tl_interp_init_base(tl_interp *in, tl_interp *base) {
+	assert(base->frozen_ns.root);
+	_tl_interp_init_state(in, base->reallocf);
+	in->ns.base = &base->frozen_ns;
+
+	in->true_ = base->true_;
+	in->false_ = base->false_;
+	in->prefixes = base->prefixes;
+	in->next_tag = base->next_tag;
+	if(base->mod_state_len) {
+		in->mod_state = tl_alloc_malloc(in, base->mod_state_len * sizeof(*in->mod_state));
+		assert(in->mod_state);
+		memcpy(in->mod_state, base->mod_state, base->mod_state_len * sizeof(*in->mod_state));
+		in->mod_state_len = base->mod_state_len;
+	}
+	for(size_t i = 0; i < base->autoload.cap; i++) {
+		size_t idx = base->autoload.vals[i];
+		if(base->autoload.keys[i] && idx) {
+			tl_autoload(in, (tl_name *)base->autoload.keys[i], base->autoloads[idx - 1].data, base->autoloads[idx - 1].len);
+		}
+	}
+
+	/* See tl_interp_freeze */
+	in->top_env = tl_new_pair(in, TL_EMPTY_LIST, tl_next(base->top_env));
+	in->env = in->top_env;
+}
+
 /** Load functions from ::tl_init_ent entries.
  *
  * This is most often done from a linker-defined section. (See the definition
@@ -111,10 +193,11 @@ tl_object *tl_interp_load_funcs(tl_interp *in, tl_object *frame, tl_init_ent *st
 #endif
 	while(start != stop) {
 #ifdef LOAD_DEBUG
-		fprintf(stderr, "Loading %s %s declared in %s:%u from %p...\n", start->flags & TL_EF_BYVAL ? "cfunc_byval" : "cfunc", start->name, start->file, start->line, start->fn);
+		fprintf(stderr, "Loading %s %s declared in %s:%u from %p...\n", start->flags & TL_EF_ARGV ? "cfunc_argv" : start->flags & TL_EF_BYVAL ? "cfunc_byval" : "cfunc", start->name, start->file, start->line, start->flags & TL_EF_ARGV ? (void *) start->fnv : (void *) start->fn);
 #endif
 		frame = _tl_frm_set(
 				start->name,
+				start->flags & TL_EF_ARGV ? tl_new_cfunc_argv(in, start) :
 				start->flags & TL_EF_BYVAL ? _tl_new_cfunc_byval(in, start->fn, start->name) : _tl_new_cfunc(in, start->fn, start->name),
 				frame
 		);
@@ -130,11 +213,54 @@ tl_object *tl_interp_load_funcs(tl_interp *in, tl_object *frame, tl_init_ent *st
  *
  * For the most part, this frees all memory allocated by the interpreter,
  * leaving many of its pointers dangling. It is undefined behavior to use an
- * interpreter after it has been finalized.
+ * interpreter after it has been finalized. Buffered output is flushed first.
  */
 void tl_interp_cleanup(tl_interp *in) {
+	tl_object *obj;
+	tl_flush(in);
+	tl_alloc_free(in, in->output_buf);
+	in->output_buf = NULL;
+	/* Thaw the frozen objects, so they're freed with the rest */
+	while((obj = in->frozen)) {
+		in->frozen = tl_next_alloc(obj);
+		obj->next_alloc = in->top_alloc;
+		obj->prev_alloc = NULL;
+		if(in->top_alloc) in->top_alloc->prev_alloc = obj;
+		in->top_alloc = obj;
+	}
 	while(in->top_alloc) {
 		tl_free(in, in->top_alloc);
 	}
 	tl_ns_free(in, &in->ns);
+	tl_ns_free(in, &in->frozen_ns);
+	tl_image_release(in);
+	tl_ptrmap_free(in, &in->autoload);
+	tl_alloc_free(in, in->autoloads);
+	in->autoloads = NULL;
+	in->nautoloads = in->szautoloads = 0;
+	tl_alloc_free(in, in->mod_state);
+	in->mod_state = NULL;
+	in->mod_state_len = 0;
+}
+
+/** Find a module's state in this interpreter.
+ *
+ * Modules can be loaded into many interpreters at once, possibly on different
+ * threads, so they shouldn't keep per-interpreter values (like their
+ * ::tl_tag) in static variables. Instead, they can pass the address of any
+ * static object of their own as the `key` here, to get a slot that is unique
+ * to that key and interpreter. The slot is NULL until set, and the pointer
+ * returned is only valid until the next call.
+ */
+void **tl_mod_state(tl_interp *in, const void *key) {
+	size_t i;
+	for(i = 0; i < in->mod_state_len; i++) {
+		if(in->mod_state[i].key == key) return &in->mod_state[i].value;
+	}
+	in->mod_state = tl_alloc_realloc(in, in->mod_state, (i + 1) * sizeof(*in->mod_state));
+	assert(in->mod_state);
+	in->mod_state[i].key = key;
+	in->mod_state[i].value = NULL;
+	in->mod_state_len++;
+	return &in->mod_state[i].value;
 }
@@ -5,50 +5,237 @@
 
 #ifdef UNIX
 #include <unistd.h>
+#include <fcntl.h>
 #include <errno.h>
 #endif
 
 #include "tinylisp.h"
 
-static int _standard_readf(tl_interp *in) { return getchar(); }
+#ifndef MAIN_READ_CHUNK
+/** The size of the chunks read from input files and standard input. */
+#define MAIN_READ_CHUNK 65536
+#endif
 
 struct input_ent {
 	struct input_ent *next;
 	char *name;
-	FILE *input;
-} *inputs = NULL;
-
-static int _input_readf(tl_interp *in) {
-retry:
-	if(inputs) {
-		int result = fgetc(inputs->input);
-		if(result == EOF) {
-			struct input_ent *next = inputs->next;
-			free(inputs);
-			inputs = next;
-			goto retry;
+	int fd;
+	/** With a cache directory, the whole text (read ahead to hash it), and
+	 * whether it was handed to the reader yet.
+	 */
+	char *text;
+	size_t len;
+	int given;
+	/** Set once the input was looked up in the cache, before its first form. */
+	int started;
+	/** Set when the cache had the input's forms, which are then in `cached`. */
+	int hit;
+	tl_form_reader cached;
+	/** Set while the forms read from the text (in `forms`) can be cached. */
+	int cacheable;
+	tl_form_writer forms;
+	/** The cache key of the input; see _main_cache_open . */
+	unsigned long long key;
+	/** Set when a top-level read reached the end of the text. */
+	int eof;
+};
+
+/** The REPL's state, kept per interpreter in tl_interp::udata . */
+struct main_state {
+	/** The level of output; one of the QUIET_ values below. */
+	int quiet;
+	/** Cleared once the interpreter has been cleaned up at the end of input. */
+	int running;
+	/** The files to read, in order, before standard input. */
+	struct input_ent *inputs;
+	/** The directory to cache the forms of inputs in, or NULL. */
+	const char *cache_dir;
+	/** The buffer of chunks read by _input_readbuf . */
+	char *chunk;
+	/** Set while the REPL (rather than the program) is reading a form. */
+	int reading;
+	/** Where in tl_interp::input_buf that read started, and where the last
+	 * one ended.
+	 */
+	const char *read_buf;
+	size_t read_start, read_end;
+#ifdef INITSCRIPTS
+	/** The pre-parsed forms of the built-in init scripts left to run. */
+	tl_form_reader initscripts;
+#endif
+};
+#define main_state(in) ((struct main_state *)(in)->udata)
+
+static void _main_next_input(tl_interp *);
+
+static void _main_writebuf(tl_interp *in, const char *data, size_t len) {
+	fwrite(data, 1, len, stdout);
+}
+
+/* Make all output so far visible. */
+static void _main_flush(tl_interp *in) {
+	tl_flush(in);
+	fflush(stdout);
+}
+
+/* Whether the read in progress has consumed any text but whitespace. */
+static int _main_read_partial(tl_interp *in) {
+	struct main_state *st = main_state(in);
+	size_t i = st->read_buf == in->input_buf ? st->read_start : 0;
+	for(; i < in->input_len; i++) {
+		char c = in->input_buf[i];
+		if(c != ' ' && c != '\n' && c != '\t' && c != '\r') return 1;
+	}
+	return 0;
+}
+
+/* Hand the reader the next chunk of the inputs, then standard input. */
+static int _input_readbuf(tl_interp *in, const char **data, size_t *len) {
+	struct main_state *st = main_state(in);
+	struct input_ent *ent;
+	ssize_t n;
+	while((ent = st->inputs)) {
+		if(ent->text) {
+			if(!ent->given && ent->len) {
+				ent->given = 1;
+				*data = ent->text;
+				*len = ent->len;
+				return 1;
+			}
+		} else if((n = read(ent->fd, st->chunk, MAIN_READ_CHUNK)) > 0) {
+			*data = st->chunk;
+			*len = n;
+			return 1;
 		}
-		return result;
-	} else {
-		in->readf = _standard_readf;
-		return _standard_readf(in);
+		if(st->cache_dir) {
+			/* Stop between forms, so the next input can come from the cache */
+			if(st->reading && !_main_read_partial(in)) {
+				ent->eof = 1;
+				return 0;
+			}
+			/* Otherwise, the next input starts in the middle of a read */
+			ent->cacheable = 0;
+			if(ent->next) ent->next->started = 1;
+		}
+		_main_next_input(in);
 	}
+	_main_flush(in);
+	if((n = read(STDIN_FILENO, st->chunk, MAIN_READ_CHUNK)) <= 0) return 0;
+	*data = st->chunk;
+	*len = n;
+	return 1;
 }
 
-#ifdef INITSCRIPTS
-extern char __start_tl_init_scripts, __stop_tl_init_scripts;
+/* The FNV-1a hash, continued from h. */
+static unsigned long long _main_hash(unsigned long long h, const void *data, size_t len) {
+	const unsigned char *p = data;
+	while(len--) {
+		h ^= *p++;
+		h *= 0x100000001b3ULL;
+	}
+	return h;
+}
 
-static int _initscript_readf(tl_interp *in) {
-	static char *ptr = &__start_tl_init_scripts;
-	if(ptr >= &__stop_tl_init_scripts) {
-		in->readf = _input_readf;
-		return _input_readf(in);
+/* Read all of a file into memory, returning NULL on failure. */
+static char *_main_slurp(int fd, size_t *len) {
+	size_t sz = 4096;
+	ssize_t n;
+	char *data = malloc(sz), *grown;
+	*len = 0;
+	while(data && (n = read(fd, data + *len, sz - *len)) > 0) {
+		*len += n;
+		if(*len == sz) {
+			if(!(grown = realloc(data, sz *= 2))) free(data);
+			data = grown;
+		}
 	}
-	return (int) *ptr++;
+	return data;
+}
+
+static void _main_cache_path(struct main_state *st, struct input_ent *ent, char *path, size_t sz) {
+	snprintf(path, sz, "%s/%016llx.tlc", st->cache_dir, ent->key);
 }
-#endif
 
-tl_interp *_global_in;  /* Here mostly for debugger access */
+/* Look an input up in the cache, before reading any of it.
+ *
+ * Cache files are named after a hash of the reader's build, the prefixes in
+ * effect, and the text of the input--everything that decides which forms are
+ * read from it, assuming the forms it runs on the way change the prefixes the
+ * same way every time. A file holds the encoded forms (see serial.c), followed
+ * by the key, so that truncated files aren't used.
+ *
+ * On a miss, the forms read are written to the cache at the end of the input,
+ * unless the program read any of its text itself (with tl-read, say), or any
+ * form spanned the end of it.
+ */
+static void _main_cache_open(tl_interp *in, struct input_ent *ent) {
+	struct main_state *st = main_state(in);
+	tl_form_writer prefixes;
+	unsigned long long key = 0xcbf29ce484222325ULL;
+	char path[4096];
+	unsigned char trailer[8];
+	char *data;
+	size_t len;
+	int i, fd;
+
+	ent->started = 1;
+	if(!st->cache_dir || in->is_putback || !(ent->text = _main_slurp(ent->fd, &ent->len))) return;
+	key = _main_hash(key, tl_build_id(), strlen(tl_build_id()));
+	tl_form_writer_init(in, &prefixes);
+	tl_form_encode(in, &prefixes, in->prefixes);
+	key = _main_hash(key, prefixes.data, prefixes.len);
+	tl_form_writer_free(in, &prefixes);
+	ent->key = _main_hash(key, ent->text, ent->len);
+
+	_main_cache_path(st, ent, path, sizeof(path));
+	if((fd = open(path, O_RDONLY)) >= 0) {
+		data = _main_slurp(fd, &len);
+		close(fd);
+		for(i = 0; i < 8; i++) trailer[i] = (unsigned char)(ent->key >> (i * 8));
+		if(data && len >= 8 && !memcmp(data + len - 8, trailer, 8) && tl_form_reader_init(&ent->cached, data, len - 8)) {
+			ent->hit = 1;
+			free(ent->text);
+			ent->text = data;  /* Freed with the input */
+			return;
+		}
+		free(data);
+	}
+	tl_form_writer_init(in, &ent->forms);
+	ent->cacheable = 1;
+}
+
+static void _main_cache_store(tl_interp *in, struct input_ent *ent) {
+	char path[4096];
+	unsigned char trailer[8];
+	FILE *f;
+	int i;
+	for(i = 0; i < 8; i++) trailer[i] = (unsigned char)(ent->key >> (i * 8));
+	_main_cache_path(main_state(in), ent, path, sizeof(path));
+	/* Writers racing on the same file write the same bytes */
+	if((f = fopen(path, "wb"))) {
+		fwrite(ent->forms.data, 1, ent->forms.len, f);
+		fwrite(trailer, 1, 8, f);
+		fclose(f);
+	}
+}
+
+/* Finish the current input, and move on to the next (or standard input). */
+static void _main_next_input(tl_interp *in) {
+	struct main_state *st = main_state(in);
+	struct input_ent *ent = st->inputs;
+	if(ent->cacheable) _main_cache_store(in, ent);
+	tl_form_writer_free(in, &ent->forms);
+	tl_form_reader_free(in, &ent->cached);
+	close(ent->fd);
+	free(ent->text);
+	st->inputs = ent->next;
+	free(ent);
+}
+
+#ifdef INITSCRIPTS
+/* Written by tlforms at build time; see the Makefile */
+extern char __start_tl_init_scripts, __stop_tl_init_scripts;
+#endif
 
 #ifdef CONFIG_MODULES
 #include <dlfcn.h>
@@ -71,22 +258,20 @@ int my_modloadf(tl_interp *in, const char *fname) {
 #define QUIET_NO_PROMPT (1)
 #define QUIET_NO_TRUE (2)
 #define QUIET_NO_VALUE (3)
-int quiet = QUIET_OFF;
-#define tl_prompt(...) if(quiet == QUIET_OFF) fprintf(stderr, __VA_ARGS__)
-
-int running = 1;
+#define tl_prompt(...) if(main_state(in)->quiet == QUIET_OFF) fprintf(stderr, __VA_ARGS__)
 
 void _main_k(tl_interp *in, tl_object *result, tl_object *_) {
+	int quiet = main_state(in)->quiet;
 	tl_prompt("Value: ");
 	if(quiet != QUIET_NO_VALUE && (quiet != QUIET_NO_TRUE || tl_first(result) != in->true_)) {
 		tl_print(in, tl_first(result));
 		tl_printf(in, "\n");
 	}
-	fflush(stdout);
+	_main_flush(in);
 	if(in->values) {
 		tl_prompt("(Rest of stack: ");
 		tl_print(in, in->values);
-		fflush(stdout);
+		_main_flush(in);
 		tl_prompt(")\n");
 	}
 	tl_cfunc_return(in, in->true_);
@@ -94,33 +279,88 @@ void _main_k(tl_interp *in, tl_object *result, tl_object *_) {
 
 void _main_read_k(tl_interp *in, tl_object *args, tl_object *_) {
 	tl_object *expr = tl_first(args);
+	int quiet = main_state(in)->quiet;
 	if(!expr) {
 		tl_prompt("Done.\n");
 		tl_interp_cleanup(in);
-		running = 0;
+		main_state(in)->running = 0;
 		return;  /* Don't push anything, the interpreter is already dead */
 	}
 	if(quiet == QUIET_OFF || quiet == QUIET_NO_PROMPT) {
 		tl_prompt("Read: ");
 		tl_print(in, expr);
-		fflush(stdout);
+		_main_flush(in);
 		tl_putc(in, '\n');
 	}
 	in->current = TL_EMPTY_LIST;
 	tl_eval_and_then(in, expr, NULL, _main_k);
 };
 
+/* Receives a form read from the text of the input (or standard input). */
+void _main_text_read_k(tl_interp *in, tl_object *args, tl_object *_) {
+	struct main_state *st = main_state(in);
+	struct input_ent *ent = st->inputs;
+	st->reading = 0;
+	st->read_end = in->input_pos;
+	if(ent && ent->eof && !tl_first(args)) {
+		_main_next_input(in);
+		tl_cfunc_return(in, in->true_);
+	}
+	if(ent && ent->cacheable && !tl_form_encode(in, &ent->forms, tl_first(args))) {
+		ent->cacheable = 0;
+	}
+	_main_read_k(in, args, _);
+}
+
+/* Start on the next form that doesn't need the reader--from the init scripts,
+ * or the cache--returning 0 if the next form has to be read.
+ */
+static int _main_next_form(tl_interp *in) {
+	struct main_state *st = main_state(in);
+	struct input_ent *ent;
+	tl_object *expr;
+	int res;
+#ifdef INITSCRIPTS
+	if(st->initscripts.end) {
+		if((res = tl_form_decode(in, &st->initscripts, &expr)) > 0) {
+			_main_read_k(in, tl_new_pair(in, expr, TL_EMPTY_LIST), NULL);
+			return 1;
+		}
+		if(res < 0) fprintf(stderr, "Error: malformed init scripts\n");
+		tl_form_reader_free(in, &st->initscripts);
+	}
+#endif
+	while((ent = st->inputs)) {
+		if(!ent->started) _main_cache_open(in, ent);
+		if(!ent->hit) break;
+		if((res = tl_form_decode(in, &ent->cached, &expr)) > 0) {
+			_main_read_k(in, tl_new_pair(in, expr, TL_EMPTY_LIST), NULL);
+			return 1;
+		}
+		if(res < 0) fprintf(stderr, "Error: %s: malformed cache file\n", ent->name);
+		_main_next_input(in);
+	}
+	if(ent && ent->cacheable && in->input_buf == ent->text && in->input_pos != st->read_end) {
+		/* The program read some of the text itself */
+		ent->cacheable = 0;
+	}
+	st->reading = 1;
+	st->read_buf = in->input_buf;
+	st->read_start = in->input_pos;
+	return 0;
+}
+
 TL_CFBV(quiet, "quiet") {
 	if(args) {
 		tl_object *arg = tl_first(args);
 		if(tl_is_int(arg)) {
-			quiet = (int) arg->ival;
+			main_state(in)->quiet = (int) arg->ival;
 			tl_cfunc_return(in, in->true_);
 		} else {
 			tl_error_set(in, tl_new_pair(in, tl_new_sym(in, "tl-quiet on non-int"), arg));
 		}
 	} else {
-		tl_cfunc_return(in, tl_new_int(in, (long) quiet));
+		tl_cfunc_return(in, tl_new_int(in, (long) main_state(in)->quiet));
 	}
 }
 
@@ -129,6 +369,7 @@ TL_CFBV(exit, "exit") {
 		tl_error_set(in, tl_new_pair(in, tl_new_sym(in, "tl-exit on non-int"), args));
 		tl_cfunc_return(in, in->false_);
 	}
+	_main_flush(in);
 	exit(tl_first(args)->ival);
 }
 
@@ -139,7 +380,7 @@ void _print_cont(tl_interp *in, tl_object *cont, int level) {
 	fprintf(stderr, "Len ");
 	len = tl_first(cont);
 	tl_print(in, len);
-	fflush(stdout);
+	_main_flush(in);
 	if(tl_is_int(len) && len->ival < 0) {
 		switch(len->ival) {
 			case TL_APPLY_PUSH_EVAL: fprintf(stderr, " (TL_APPLY_PUSH_EVAL)"); break;
@@ -147,12 +388,18 @@ void _print_cont(tl_interp *in, tl_object *cont, int level) {
 			case TL_APPLY_DROP_EVAL: fprintf(stderr, " (TL_APPLY_DROP_EVAL)"); break;
 			case TL_APPLY_DROP: fprintf(stderr, " (TL_APPLY_DROP)"); break;
 			case TL_APPLY_DROP_RESCUE: fprintf(stderr, " (TL_APPLY_DROP_RESCUE)"); break;
+			case TL_APPLY_GETCHAR: fprintf(stderr, " (TL_APPLY_GETCHAR)"); break;
+			case TL_APPLY_IF: fprintf(stderr, " (TL_APPLY_IF)"); break;
+			case TL_APPLY_DEFINE: fprintf(stderr, " (TL_APPLY_DEFINE)"); break;
+			case TL_APPLY_SET: fprintf(stderr, " (TL_APPLY_SET)"); break;
+			case TL_APPLY_EXIT_EC: fprintf(stderr, " (TL_APPLY_EXIT_EC)"); break;
+			case TL_APPLY_PROMPT: fprintf(stderr, " (TL_APPLY_PROMPT)"); break;
 		}
 	}
 	fprintf(stderr, " Callex ");
 	callex = tl_first(tl_next(cont));
 	tl_print(in, callex);
-	fflush(stdout);
+	_main_flush(in);
 	if(tl_is_then(callex) && callex->state) {
 		/* I'd like to see where this is proven wrong */
 		fprintf(stderr, " Returns to ");
@@ -206,21 +453,37 @@ extern void *__stop_tl_module_init;
 
 int main(int argc, char **argv) {
 	tl_interp real_in, *in = &real_in;
+	struct main_state state = { .quiet = QUIET_OFF, .running = 1, .inputs = NULL, .cache_dir = NULL };
 	tl_object *expr, *val;
-
-	_global_in = in;
+	const char *image = NULL;
+	int first_input = 1;
 
 #ifdef UNIX
 	if(!isatty(STDIN_FILENO)) {
-		quiet = QUIET_NO_TRUE;
+		state.quiet = QUIET_NO_TRUE;
 	}
 
-	for(int i = argc - 1; i >= 1; i--) {
+	/* --image FILE: start from a heap image (see tl_image_save)
+	 * --cache DIR: cache the forms read from files in DIR (see _main_cache_open)
+	 */
+	while(first_input + 1 < argc) {
+		if(!strcmp(argv[first_input], "--image")) {
+			image = argv[first_input + 1];
+		} else if(!strcmp(argv[first_input], "--cache")) {
+			state.cache_dir = argv[first_input + 1];
+		} else {
+			break;
+		}
+		first_input += 2;
+	}
+
+	for(int i = argc - 1; i >= first_input; i--) {
 		struct input_ent *ent = malloc(sizeof(struct input_ent));
-		ent->next = inputs;
-		inputs = ent;
+		memset(ent, 0, sizeof(*ent));
+		ent->next = state.inputs;
+		state.inputs = ent;
 		ent->name = argv[i];
-		if(!(ent->input = fopen(argv[i], "r"))) {
+		if((ent->fd = open(argv[i], O_RDONLY)) < 0) {
 			fprintf(stderr, "%s: %s\n", argv[i], strerror(errno));
 			return 100;  // leaks, but dies immediately
 		}
@@ -228,13 +491,24 @@ int main(int argc, char **argv) {
 #endif
 
 	tl_interp_init(in);
+	in->udata = &state;
+	if(image && !tl_image_load(in, image)) {
+		fprintf(stderr, "%s: not a usable image\n", image);
+		return 100;
+	}
 #ifdef CONFIG_MODULES
 	in->modloadf = my_modloadf;
+#endif
+	in->writebuf = _main_writebuf;
+#ifdef UNIX
+	in->flush_lines = isatty(STDOUT_FILENO);
+	state.chunk = malloc(MAIN_READ_CHUNK);
+	in->readbuf = _input_readbuf;
 #endif
 #ifdef INITSCRIPTS
-	in->readf = _initscript_readf;
-#else
-	in->readf = _input_readf;
+	if(!tl_form_reader_init(&state.initscripts, &__start_tl_init_scripts, &__stop_tl_init_scripts - &__start_tl_init_scripts)) {
+		fprintf(stderr, "Error: malformed init scripts\n");
+	}
 #endif
 #ifdef SHARED_LIB
 	TL_LOAD_FUNCS;
@@ -247,35 +521,35 @@ int main(int argc, char **argv) {
 	}
 #endif
 
-	if(quiet == QUIET_OFF) {
+	if(state.quiet == QUIET_OFF) {
 		tl_prompt("Top Env: ");
 		tl_print(in, in->top_env);
 #ifdef NS_DEBUG
 		tl_prompt("Namespace:\n");
 		tl_ns_print(in, &in->ns);
 #endif
-		fflush(stdout);
+		_main_flush(in);
 		tl_prompt("\n");
 	}
 
-	while(running) {
+	while(state.running) {
 		tl_prompt("> ");
-		tl_read_and_then(in, _main_read_k, TL_EMPTY_LIST);
+		if(!_main_next_form(in)) {
+			tl_read_and_then(in, _main_text_read_k, TL_EMPTY_LIST);
+		}
 #ifdef FAKE_ASYNC
-		while(1) {
-			int res = tl_apply_next(in);
-			if(!res) break;
-			switch(res) {
-				case TL_RESULT_AGAIN: break;
-				case TL_RESULT_GETCHAR:
-					tl_values_push(in, tl_new_int(in, getchar()));
-					break;
-			}
+		while(tl_run_for(in, 0, 0, NULL) == TL_RESULT_GETCHAR) {
+			tl_values_push(in, tl_new_int(in, tl_getc(in)));
 		}
 #else
 		tl_run_until_done(in);
 #endif
-		if(!running) {
+		if(state.reading && state.inputs) {
+			/* The form was never read (an error in the reader, say) */
+			state.inputs->cacheable = 0;
+		}
+		state.reading = 0;
+		if(!state.running) {
 			/* Don't inspect anything--tl_interp_cleanup was
 			 * already called, so these values are
 			 * poisonous.
@@ -283,14 +557,17 @@ int main(int argc, char **argv) {
 			break;
 		}
 		if(in->error) {
+			/* Labeled, so that a cyclic value in an error can't hang the REPL */
+			tl_print_opts err_opts = in->print_opts;
+			err_opts.labels = 1;
 			/* Don't change these to tl_prompt--errors are always exceptional */
 			fprintf(stderr, "Error: ");
-			tl_print(in, in->error);
-			fflush(stdout);
+			tl_print_with(in, in->error, &err_opts);
+			_main_flush(in);
 			print_cont_stack(in, in->conts);
 			fprintf(stderr, "\nValues: ");
-			tl_print(in, in->values);
-			fflush(stdout);
+			tl_print_with(in, in->values, &err_opts);
+			_main_flush(in);
 			for(tl_list_iter(in->env, frm)) {
 				fprintf(stderr, "\nFrame");
 				if(!tl_next(l_frm)) {
@@ -300,8 +577,8 @@ int main(int argc, char **argv) {
 					fprintf(stderr, "(Inner)");
 				}
 				fprintf(stderr, ": ");
-				tl_print(in, frm);
-				fflush(stdout);
+				tl_print_with(in, frm, &err_opts);
+				_main_flush(in);
 			}
 			fprintf(stderr, "\n");
 			tl_error_clear(in);
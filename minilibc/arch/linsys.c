@@ -99,4 +99,6 @@ void arch_release_heap(void *region, size_t sz) {
 }
 
 int main();
+/* The kernel enters with the stack 16-byte aligned, not as if by a call. */
+__attribute__((force_align_arg_pointer))
 void _start() { main(); arch_halt(0); }
@@ -0,0 +1,8 @@
+#ifndef MINILIB_FCNTL_H
+#define MINILIB_FCNTL_H
+
+#define O_RDONLY 0
+
+int open(const char *, int, ...);
+
+#endif
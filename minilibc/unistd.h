@@ -1,10 +1,16 @@
 #ifndef MINILIB_UNISTD_H
 #define MINILIB_UNISTD_H
 
+#include <stddef.h>
+
 #define STDIN_FILENO 0
 #define STDOUT_FILENO 1
 #define STDERR_FILENO 2
 
+typedef long ssize_t;
+
 int isatty(int);
+ssize_t read(int, void *, size_t);
+int close(int);
 
 #endif
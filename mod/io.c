@@ -6,10 +6,12 @@ static void _free_filep(tl_interp *in, tl_object *ptr) {
 	fclose(ptr->ptr);
 }
 
-static tl_tag FILE_TAG;
+/* This module's state in each interpreter (see tl_mod_state) is its tag. */
+static const char file_tag_key;
+#define FILE_TAG ((tl_tag)*tl_mod_state(in, &file_tag_key))
 
 TL_MOD_INIT(tl_interp *in, const char *fname) {
-	FILE_TAG = tl_new_tag(in);
+	*tl_mod_state(in, &file_tag_key) = (void *)tl_new_tag(in);
 	TL_LOAD_FUNCS;
 	return 1;
 }
@@ -62,3 +64,25 @@ TL_CFBV(io_write, "io-write") {
 	}
 	tl_cfunc_return(in, tl_new_int(in, bytes));
 }
+
+TL_CFBV(io_serialize, "io-serialize") {
+	tl_object *fobj = tl_first(args);
+	tl_form_writer w;
+	int ok;
+	/* Each value is a complete stream, which io-deserialize reads back alone */
+	if(!tl_is_tag(fobj, FILE_TAG) || !fobj->ptr) tl_cfunc_return(in, in->false_);
+	tl_form_writer_init_file(in, &w, fobj->ptr);
+	w.shared = 1;
+	ok = tl_form_encode(in, &w, tl_first(tl_next(args)));
+	tl_form_writer_free(in, &w);
+	tl_cfunc_return(in, ok ? in->true_ : in->false_);
+}
+
+TL_CFBV(io_deserialize, "io-deserialize") {
+	tl_object *fobj = tl_first(args), *ret = in->false_;
+	tl_form_reader r;
+	if(!tl_is_tag(fobj, FILE_TAG) || !fobj->ptr) tl_cfunc_return(in, in->false_);
+	if(tl_form_reader_init_file(in, &r, fobj->ptr) && tl_form_decode(in, &r, &ret) <= 0) ret = in->false_;
+	tl_form_reader_free(in, &r);
+	tl_cfunc_return(in, ret);
+}
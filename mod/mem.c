@@ -4,10 +4,12 @@
 
 #define fail(msg) tl_error_set(in, tl_new_pair(in, tl_new_sym(in, msg), args)); tl_cfunc_return(in, in->false_)
 
-static tl_tag PTR_TAG;
+/* This module's state in each interpreter (see tl_mod_state) is its tag. */
+static const char ptr_tag_key;
+#define PTR_TAG ((tl_tag)*tl_mod_state(in, &ptr_tag_key))
 
 TL_MOD_INIT(tl_interp *in, const char *fname) {
-	PTR_TAG = tl_new_tag(in);
+	*tl_mod_state(in, &ptr_tag_key) = (void *)tl_new_tag(in);
 	TL_LOAD_FUNCS;
 	return 1;
 }
@@ -35,6 +35,7 @@ static tl_name *tl_ns_split(tl_interp *in, tl_child *child, size_t len) {
 	new_name->children->name = child->name;
 	/* Name the new node */
 	new_name->here = tl_buf_slice(in, child->name->here, 0, child->name->here.len - child->seg.len + len);
+	new_name->quoted = _tl_print_needs_quotes(new_name->here);
 	/* Copy the suffix into the new child */
 	new_name->children->seg = tl_buf_slice(in, child->seg, len, child->seg.len);
 	/* ...and reallocate the current segment */
@@ -46,6 +47,44 @@ static tl_name *tl_ns_split(tl_interp *in, tl_child *child, size_t len) {
 	return new_name;
 }
 
+/** Find a name in a namespace (or its bases) without changing it.
+ *
+ * Returns NULL if the name isn't there. Unlike ::tl_ns_resolve , this never
+ * splits a node, so it is safe to call on a namespace shared between threads.
+ * Siblings in the trie never share a first byte, so that is all the search
+ * below needs to compare.
+ */
+tl_name *tl_ns_find(tl_ns *ns, tl_buffer name) {
+	for(; ns; ns = ns->base) {
+		tl_name *cur = ns->root;
+		tl_buffer rest = name;
+		while(cur && rest.len) {
+			size_t low = 0, high = cur->num_children, index;
+			tl_child *child = NULL;
+			while(low < high) {
+				index = (low + high) / 2;
+				if((unsigned char)cur->children[index].seg.data[0] < (unsigned char)rest.data[0]) {
+					low = index + 1;
+				} else if((unsigned char)cur->children[index].seg.data[0] > (unsigned char)rest.data[0]) {
+					high = index;
+				} else {
+					child = cur->children + index;
+					break;
+				}
+			}
+			if(!child || child->seg.len > rest.len || memcmp(child->seg.data, rest.data, child->seg.len)) {
+				cur = NULL;
+			} else {
+				cur = child->name;
+				rest.data += child->seg.len;
+				rest.len -= child->seg.len;
+			}
+		}
+		if(cur) return cur;
+	}
+	return NULL;
+}
+
 tl_name *tl_ns_resolve(tl_interp *in, tl_ns *ns, tl_buffer name) {
 	tl_name *cur = ns->root;
 	tl_child *children;
@@ -53,6 +92,9 @@ tl_name *tl_ns_resolve(tl_interp *in, tl_ns *ns, tl_buffer name) {
 	int sign;
 	tl_buffer whole_name = name;
 
+	if(ns->base && (cur = tl_ns_find(ns->base, name))) return cur;
+	cur = ns->root;
+
 recurse:
 #ifdef NS_DEBUG
 	tl_printf(in, "tl_ns_resolve: name %N cur here %N\n", &name, &cur->here);
@@ -232,6 +274,7 @@ recurse:
 #endif
 	cur = cur->children[low].name;
 	cur->here = tl_buf_slice(in, whole_name, 0, whole_name.len);
+	cur->quoted = _tl_print_needs_quotes(cur->here);
 	cur->num_children = cur->sz_children = 0;
 	cur->children = NULL;
 
@@ -245,8 +288,10 @@ void tl_ns_init(tl_interp *in, tl_ns *ns) {
 	ns->root = tl_alloc_malloc(in, sizeof(tl_name));
 	ns->root->here.data = NULL;
 	ns->root->here.len = 0;
+	ns->root->quoted = 1;
 	ns->root->num_children = ns->root->sz_children = 0;
 	ns->root->children = NULL;
+	ns->base = NULL;
 }
 
 void tl_ns_free(tl_interp *in, tl_ns *ns) {
@@ -139,6 +139,7 @@ tl_object *tl_new_then(tl_interp *in, void (*cfunc)(tl_interp *, tl_object *, tl
 	obj->cfunc = cfunc;
 	obj->state = state;
 	obj->name = name ? tl_strdup(in, name) : NULL;
+	obj->ent = NULL;
 	return obj;
 }
 
@@ -167,6 +168,17 @@ tl_object *_tl_new_cfunc_byval(tl_interp *in, void (*cfunc)(tl_interp *, tl_obje
 	return obj;
 }
 
+/** Creates a new "by-value" C function taking an argument array.
+ *
+ * The function and its arity are taken from `ent`, which must outlive the
+ * object (it usually lives in a `tl_init_ents` section). See ::TL_CFBV_N .
+ */
+tl_object *tl_new_cfunc_argv(tl_interp *in, const tl_init_ent *ent) {
+	tl_object *obj = _tl_new_cfunc_byval(in, NULL, ent->name);
+	obj->ent = ent;
+	return obj;
+}
+
 /** Creates a new macro.
  *
  * This is rarely needed from C (except for tl-macro).
@@ -181,6 +193,26 @@ tl_object *tl_new_macro(tl_interp *in, tl_object *args, tl_object *envn, tl_obje
 	return obj;
 }
 
+/** Creates a new pure macro.
+ *
+ * A pure macro receives its arguments by name, like a macro, but not the
+ * environment; its body returns an expansion, which is then evaluated in the
+ * caller's environment. The expansion is assumed to depend only on the syntax
+ * of the arguments, so it is cached on the macro, keyed by those syntax
+ * objects, and reused the next time the same call site is evaluated.
+ * Rebinding the macro's name to a new macro naturally starts a new cache.
+ */
+tl_object *tl_new_macro_pure(tl_interp *in, tl_object *args, tl_object *body, tl_object *env) {
+	tl_object *obj = tl_new(in);
+	obj->kind = TL_MACRO;
+	obj->args = args;
+	obj->body = body;
+	obj->env = env;
+	/* No expansions yet; see tl_is_macro_pure */
+	obj->envn = TL_EMPTY_LIST;
+	return obj;
+}
+
 /** Creates a new continuation.
  *
  * These are the objects created by call-with-current-continuation (call/cc).
@@ -377,6 +409,10 @@ void tl_gc(tl_interp *in) {
 	_tl_mark_pass(in->current);
 	_tl_mark_pass(in->conts);
 	_tl_mark_pass(in->values);
+	_tl_mark_pass(in->rescue);
+	_tl_mark_pass(in->task);
+	_tl_mark_pass(in->task_root);
+	_tl_mark_pass(in->tasks);
 	/* One could make a list of the permanent objects during the unmark scan
 	 * above, but making said list would either (1) require allocation, which
 	 * the GC should NOT do, or (2) require there to be a fixed-size array set
@@ -427,6 +463,47 @@ void tl_reclaim(tl_interp *in) {
 	}
 }
 
+/** Freeze an interpreter's heap, so that others can share it.
+ *
+ * After a GC, every live object is moved from the allocation list onto
+ * tl_interp::frozen , and its namespace becomes tl_interp::frozen_ns . From
+ * then on, no interpreter's GC visits or frees these objects, and none of the
+ * core mutates them: a `set!` or `define` that would change a frozen binding
+ * instead shadows it in the interpreter's own top frame (see `env.c`). This
+ * interpreter gets a fresh top frame atop the frozen one, so it can go on
+ * evaluating; others can be started from it with ::tl_interp_init_base , on
+ * any thread, and are all the cheaper for not repeating its initialization.
+ *
+ * Since frozen code captured the frozen environment, it doesn't see such
+ * shadowing bindings; and objects with state of their own (channels,
+ * escape continuations, and the like) raise an error when they would change
+ * once frozen. So this is best done right after loading a library like
+ * `std.tl`.
+ *
+ * This must be done between evaluations (with nothing on the stacks), and only
+ * once (counting ::tl_image_load ). Returns nonzero on success.
+ */
+int tl_interp_freeze(tl_interp *in) {
+	tl_object *obj, *next;
+	if(in->frozen_ns.root || in->conts || in->values || in->task) return 0;
+	tl_gc(in);
+	for(obj = in->top_alloc; obj; obj = next) {
+		next = tl_next_alloc(obj);
+		obj->next_alloc = in->frozen;
+		obj->prev_alloc = obj;
+		tl_mark(obj);
+		in->frozen = obj;
+	}
+	in->top_alloc = NULL;
+	in->frozen_ns = in->ns;
+	tl_ns_init(in, &in->ns);
+	in->ns.base = &in->frozen_ns;
+	/* Nothing ever replaces top_env's tail, so init_base can find the frozen
+	 * environment there. */
+	in->top_env = in->env = tl_new_pair(in, TL_EMPTY_LIST, in->top_env);
+	return 1;
+}
+
 /** Returns the length of a list.
  *
  * This is defined as the number of iterations that would be done by \ref
@@ -0,0 +1,415 @@
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "tinylisp.h"
+
+#ifndef TL_POOL_QUEUE_SIZE
+/** The number of jobs the pool's queue can hold; must be a power of two.
+ *
+ * ::tl_pool_submit waits for space when the queue is full.
+ */
+#define TL_POOL_QUEUE_SIZE 1024
+#endif
+
+/** A job: some source text to evaluate, and what to do with the result. */
+struct tl_pool_job {
+	char *text;
+	size_t len;
+	tl_pool_cb cb;
+	void *arg;
+};
+
+/** A cell of the job queue, with its sequence number (see ::tl_pool_s). */
+struct tl_pool_cell {
+	size_t seq;
+	struct tl_pool_job *job;
+};
+
+/** A worker thread and its interpreter. */
+struct tl_pool_worker {
+	tl_pool *pool;
+	pthread_t thread;
+	tl_interp in;
+	/** The text being read by `_tl_pool_readbuf`, and the position in it. */
+	const char *text;
+	size_t len, pos;
+};
+
+/** A pool of interpreters on their own threads.
+ *
+ * The job queue is a bounded multi-producer, multi-consumer ring, where each
+ * cell's sequence number says whether it is ready to be written (equal to the
+ * position that will write it) or read (one past it); producers and consumers
+ * claim positions with a compare-and-swap on `head` and `tail` respectively,
+ * so neither side takes a lock. Idle workers sleep on `ready`, which counts
+ * the queued jobs.
+ */
+struct tl_pool_s {
+	struct tl_pool_cell cells[TL_POOL_QUEUE_SIZE];
+	size_t head, tail;
+	sem_t ready;
+	/** The number of jobs submitted but not finished. */
+	size_t pending;
+	pthread_mutex_t lock;
+	pthread_cond_t idle;
+	int stop;
+	size_t nthreads;
+	struct tl_pool_worker *workers;
+	/** Evaluates the prelude, then is frozen as the workers' base (see ::tl_interp_freeze). */
+	struct tl_pool_worker base;
+};
+
+static int _tl_pool_readbuf(tl_interp *in, const char **data, size_t *len) {
+	struct tl_pool_worker *w = in->udata;
+	if(w->pos >= w->len) return 0;
+	*data = w->text + w->pos;
+	*len = w->len - w->pos;
+	w->pos = w->len;
+	return 1;
+}
+
+static void _tl_pool_read_k(tl_interp *, tl_object *, tl_object *);
+
+static void _tl_pool_eval_k(tl_interp *in, tl_object *args, tl_object *_) {
+	tl_read_and_then(in, _tl_pool_read_k, tl_first(args));
+}
+
+/* The state is the value of the last expression, which is returned at EOF. */
+static void _tl_pool_read_k(tl_interp *in, tl_object *args, tl_object *last) {
+	if(!tl_first(args)) tl_cfunc_return(in, last);
+	tl_eval_and_then(in, tl_first(args), NULL, _tl_pool_eval_k);
+}
+
+/** Evaluate every expression in some text, in the given environment.
+ *
+ * Returns the value of the last expression, or `in->error` if one failed.
+ */
+static tl_object *_tl_pool_run(struct tl_pool_worker *w, const char *text, size_t len, tl_object *env) {
+	tl_interp *in = &w->in;
+	w->text = text;
+	w->len = len;
+	w->pos = 0;
+	in->input_len = in->input_pos = 0;
+	in->is_putback = 0;
+	in->env = env;
+	tl_read_and_then(in, _tl_pool_read_k, in->false_);
+	tl_run_until_done(in);
+	if(tl_has_error(in)) return in->error;
+	return tl_first(tl_first(in->values));
+}
+
+/** Finish a job, waking `tl_pool_wait` if it was the last. */
+static void _tl_pool_done(tl_pool *pool) {
+	if(__atomic_sub_fetch(&pool->pending, 1, __ATOMIC_ACQ_REL) == 0) {
+		pthread_mutex_lock(&pool->lock);
+		pthread_cond_broadcast(&pool->idle);
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+static struct tl_pool_job *_tl_pool_pop(tl_pool *pool) {
+	size_t pos = __atomic_load_n(&pool->tail, __ATOMIC_RELAXED);
+	for(;;) {
+		struct tl_pool_cell *cell = &pool->cells[pos & (TL_POOL_QUEUE_SIZE - 1)];
+		size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+		if(seq == pos + 1) {
+			if(__atomic_compare_exchange_n(&pool->tail, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				struct tl_pool_job *job = cell->job;
+				__atomic_store_n(&cell->seq, pos + TL_POOL_QUEUE_SIZE, __ATOMIC_RELEASE);
+				return job;
+			}
+		} else if(seq < pos + 1) {
+			/* Claimed by a producer that hasn't finished writing it yet. */
+			sched_yield();
+			pos = __atomic_load_n(&pool->tail, __ATOMIC_RELAXED);
+		} else {
+			pos = __atomic_load_n(&pool->tail, __ATOMIC_RELAXED);
+		}
+	}
+}
+
+static void _tl_pool_push(tl_pool *pool, struct tl_pool_job *job) {
+	size_t pos = __atomic_load_n(&pool->head, __ATOMIC_RELAXED);
+	for(;;) {
+		struct tl_pool_cell *cell = &pool->cells[pos & (TL_POOL_QUEUE_SIZE - 1)];
+		size_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+		if(seq == pos) {
+			if(__atomic_compare_exchange_n(&pool->head, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				cell->job = job;
+				__atomic_store_n(&cell->seq, pos + 1, __ATOMIC_RELEASE);
+				return;
+			}
+		} else if(seq < pos) {
+			/* Full; wait for a worker to take something. */
+			sched_yield();
+			pos = __atomic_load_n(&pool->head, __ATOMIC_RELAXED);
+		} else {
+			pos = __atomic_load_n(&pool->head, __ATOMIC_RELAXED);
+		}
+	}
+}
+
+static void *_tl_pool_worker(void *arg) {
+	struct tl_pool_worker *w = arg;
+	tl_pool *pool = w->pool;
+	tl_interp *in = &w->in;
+	struct tl_pool_job *job;
+	tl_object *result;
+
+	for(;;) {
+		while(sem_wait(&pool->ready));
+		if(__atomic_load_n(&pool->stop, __ATOMIC_ACQUIRE)) break;
+		job = _tl_pool_pop(pool);
+		/* Each job gets its own frame, so its definitions don't outlive it. */
+		result = _tl_pool_run(w, job->text, job->len, tl_new_pair(in, TL_EMPTY_LIST, in->top_env));
+		if(job->cb) job->cb(in, result, job->arg);
+		tl_interp_reset(in);
+		/* Globals the job changed are shadowed in the worker's own top frame
+		 * (the rest is frozen); empty it, so they don't leak into the next job. */
+		in->top_env->first = TL_EMPTY_LIST;
+		in->env = in->top_env;
+		tl_gc(in);
+		free(job->text);
+		free(job);
+		_tl_pool_done(pool);
+	}
+	return NULL;
+}
+
+/** Stop the first `started` of a pool's worker threads, then free it all. */
+static void _tl_pool_free(tl_pool *pool, size_t started) {
+	size_t i;
+	__atomic_store_n(&pool->stop, 1, __ATOMIC_RELEASE);
+	for(i = 0; i < started; i++) sem_post(&pool->ready);
+	for(i = 0; i < started; i++) pthread_join(pool->workers[i].thread, NULL);
+	for(i = 0; i < pool->nthreads; i++) tl_interp_cleanup(&pool->workers[i].in);
+	tl_interp_cleanup(&pool->base.in);
+	sem_destroy(&pool->ready);
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->idle);
+	free(pool->workers);
+	free(pool);
+}
+
+/** Create a pool of `nthreads` interpreters, each on its own thread.
+ *
+ * First, `prelude` (usually the contents of `std.tl`) is evaluated at top
+ * level in a base interpreter, which is then frozen (see ::tl_interp_freeze)
+ * and shared by all of the workers, so that jobs submitted with
+ * ::tl_pool_submit start "warm" without each worker repeating that work.
+ * Returns NULL if the prelude failed, the base couldn't be frozen (say, it
+ * left a task running), or the workers couldn't be allocated or started.
+ */
+tl_pool *tl_pool_create(size_t nthreads, const char *prelude) {
+	tl_pool *pool = calloc(1, sizeof(*pool));
+	size_t i;
+	int frozen = 0;
+	if(!pool) return NULL;
+	pool->base.pool = pool;
+	tl_interp_init(&pool->base.in);
+	pool->base.in.udata = &pool->base;
+	pool->base.in.readbuf = _tl_pool_readbuf;
+	if(prelude) _tl_pool_run(&pool->base, prelude, strlen(prelude), pool->base.in.top_env);
+	if(!tl_has_error(&pool->base.in)) {
+		tl_interp_reset(&pool->base.in);
+		frozen = tl_interp_freeze(&pool->base.in);
+	}
+	if(!frozen) {
+		tl_interp_cleanup(&pool->base.in);
+		free(pool);
+		return NULL;
+	}
+
+	for(i = 0; i < TL_POOL_QUEUE_SIZE; i++) pool->cells[i].seq = i;
+	sem_init(&pool->ready, 0, 0);
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->idle, NULL);
+	pool->workers = calloc(nthreads, sizeof(*pool->workers));
+	if(nthreads && !pool->workers) {
+		_tl_pool_free(pool, 0);
+		return NULL;
+	}
+	pool->nthreads = nthreads;
+	for(i = 0; i < nthreads; i++) {
+		struct tl_pool_worker *w = &pool->workers[i];
+		w->pool = pool;
+		tl_interp_init_base(&w->in, &pool->base.in);
+		w->in.udata = w;
+		w->in.readbuf = _tl_pool_readbuf;
+	}
+	for(i = 0; i < nthreads; i++) {
+		if(pthread_create(&pool->workers[i].thread, NULL, _tl_pool_worker, &pool->workers[i])) {
+			_tl_pool_free(pool, i);
+			return NULL;
+		}
+	}
+	return pool;
+}
+
+/** Queue some text to be evaluated by one of a pool's interpreters.
+ *
+ * The text (of which a copy is made) may contain any number of expressions,
+ * evaluated in order in a fresh frame atop the worker's top-level environment.
+ * Nothing a job does to that environment outlives it: definitions and
+ * changes to globals are dropped before the worker's next job.
+ * Then, on the worker's thread, `cb` is called with the worker's interpreter,
+ * the value of the last expression (or the error, if `tl_has_error`), and
+ * `arg`; the objects are only valid until it returns. `cb` may be NULL.
+ *
+ * Returns nonzero on success. This may be called from any thread.
+ */
+int tl_pool_submit(tl_pool *pool, const char *text, tl_pool_cb cb, void *arg) {
+	struct tl_pool_job *job = malloc(sizeof(*job));
+	if(!job) return 0;
+	job->len = strlen(text);
+	job->text = malloc(job->len + 1);
+	if(!job->text) {
+		free(job);
+		return 0;
+	}
+	memcpy(job->text, text, job->len + 1);
+	job->cb = cb;
+	job->arg = arg;
+	__atomic_add_fetch(&pool->pending, 1, __ATOMIC_ACQ_REL);
+	_tl_pool_push(pool, job);
+	sem_post(&pool->ready);
+	return 1;
+}
+
+/** Wait until every job submitted to the pool so far has finished. */
+void tl_pool_wait(tl_pool *pool) {
+	pthread_mutex_lock(&pool->lock);
+	while(__atomic_load_n(&pool->pending, __ATOMIC_ACQUIRE)) pthread_cond_wait(&pool->idle, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/** Wait for the pool's jobs, then stop its threads and free it. */
+void tl_pool_destroy(tl_pool *pool) {
+	tl_pool_wait(pool);
+	_tl_pool_free(pool, pool->nthreads);
+}
+
+/** A run of text being read by ::tl_read_parallel , with its own interpreter. */
+struct tl_pool_chunk {
+	pthread_t thread;
+	tl_interp in;
+	const char *text;
+	size_t len, forms;
+	/** The forms read, encoded, to be decoded into the caller's interpreter. */
+	tl_form_writer out;
+	int ok, started;
+};
+
+static int _tl_pool_chunk_readbuf(tl_interp *in, const char **data, size_t *len) {
+	return 0;
+}
+
+static void _tl_pool_chunk_k(tl_interp *in, tl_object *args, tl_object *_) {
+	struct tl_pool_chunk *c = in->udata;
+	if(!tl_form_encode(in, &c->out, tl_first(args))) c->ok = 0;
+	tl_cfunc_return(in, in->true_);
+}
+
+static void *_tl_pool_chunk(void *arg) {
+	struct tl_pool_chunk *c = arg;
+	tl_interp *in = &c->in;
+	size_t i;
+	in->input_buf = c->text;
+	in->input_len = c->len;
+	in->input_pos = 0;
+	for(i = 0; i < c->forms && c->ok; i++) {
+		tl_read_and_then(in, _tl_pool_chunk_k, NULL);
+		tl_run_until_done(in);
+		if(tl_has_error(in)) c->ok = 0;
+		tl_interp_reset(in);
+	}
+	return NULL;
+}
+
+/** Read all of the forms in some text, splitting the work among `nthreads` threads.
+ *
+ * The text is split into runs of whole forms with ::tl_read_split , each read
+ * by a fresh interpreter (with a copy of `in`'s prefixes) on its own thread,
+ * into an encoded stream (see ::tl_form_encode); then the streams are decoded
+ * into `in`, in order. The result is a list of the forms, as reading them one
+ * by one with `tl_read` would give, and `*used` is set to the length of the
+ * text they cover; whatever is left (an unfinished form, or a stray `)`) can
+ * be read the usual way. The end of the text is taken as the end of input.
+ *
+ * Unlike reading and evaluating each form in turn, every form is read before
+ * any is evaluated, so prefixes defined by the text don't apply to it. If the
+ * prefixes can't be copied, nothing is read (and `*used` is 0).
+ */
+tl_object *tl_read_parallel(tl_interp *in, const char *text, size_t len, size_t nthreads, size_t *used) {
+	size_t *cuts, *forms, i;
+	struct tl_pool_chunk *chunks;
+	tl_form_writer pw;
+	tl_form_reader r;
+	tl_object *result = TL_EMPTY_LIST, *form;
+
+	*used = 0;
+	if(!nthreads) nthreads = 1;
+	tl_form_writer_init(in, &pw);
+	if(!tl_form_encode(in, &pw, in->prefixes)) {
+		tl_form_writer_free(in, &pw);
+		return NULL;
+	}
+	cuts = malloc((nthreads + 1) * sizeof(*cuts));
+	forms = malloc(nthreads * sizeof(*forms));
+	chunks = calloc(nthreads, sizeof(*chunks));
+	if(!cuts || !forms || !chunks) goto out;
+	tl_read_split(in, text, len, nthreads, cuts, forms);
+
+	for(i = 0; i < nthreads; i++) {
+		struct tl_pool_chunk *c = &chunks[i];
+		c->ok = 1;
+		if(!forms[i]) continue;
+		c->text = text + cuts[i];
+		c->len = cuts[i + 1] - cuts[i];
+		c->forms = forms[i];
+		tl_interp_init(&c->in);
+		c->in.udata = c;
+		c->in.readbuf = _tl_pool_chunk_readbuf;
+		tl_form_reader_init(&r, pw.data, pw.len);
+		if(tl_form_decode(&c->in, &r, &form) > 0) c->in.prefixes = form;
+		tl_form_reader_free(&c->in, &r);
+		tl_form_writer_init(&c->in, &c->out);
+	}
+	/* The first run is read on this thread, while the others are going */
+	for(i = 1; i < nthreads; i++) {
+		if(forms[i]) chunks[i].started = !pthread_create(&chunks[i].thread, NULL, _tl_pool_chunk, &chunks[i]);
+	}
+	if(forms[0]) _tl_pool_chunk(&chunks[0]);
+
+	for(i = 0; i < nthreads; i++) {
+		struct tl_pool_chunk *c = &chunks[i];
+		if(!forms[i]) continue;
+		if(c->started) pthread_join(c->thread, NULL);
+		else if(i) _tl_pool_chunk(c);
+	}
+	for(i = 0; i < nthreads; i++) {
+		struct tl_pool_chunk *c = &chunks[i];
+		if(!c->ok) break;
+		*used = cuts[i + 1];
+		if(!forms[i]) continue;
+		tl_form_reader_init(&r, c->out.data, c->out.len);
+		while(tl_form_decode(in, &r, &form) > 0) result = tl_new_pair(in, form, result);
+		tl_form_reader_free(in, &r);
+	}
+	result = tl_list_rvs(in, result);
+
+	for(i = 0; i < nthreads; i++) {
+		if(!forms[i]) continue;
+		tl_form_writer_free(&chunks[i].in, &chunks[i].out);
+		tl_interp_cleanup(&chunks[i].in);
+	}
+out:
+	tl_form_writer_free(in, &pw);
+	free(cuts);
+	free(forms);
+	free(chunks);
+	return result;
+}
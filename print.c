@@ -1,57 +1,136 @@
 #include <string.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <assert.h>
 
 #include "tinylisp.h"
 
 #define QUOTED_SYM_CHARS "0123456789.,'\"` \n\r\t\b\v"
 
-tl_object *_tl_print(tl_interp *, tl_object *, size_t);
+#ifndef TL_PRINT_STACK_INLINE
+/** The number of printer stack frames kept on the C stack; deeper structures
+ * grow the stack on the heap.
+ */
+#define TL_PRINT_STACK_INLINE 32
+#endif
 
-static void _indent(tl_interp *in, size_t level) {
-	while(level--) tl_putc(in, in->disp_indent);
+/** Decide whether a symbol with this name has to be printed in quotes.
+ *
+ * This is computed once per name, as it is created (see tl_name::quoted).
+ */
+int _tl_print_needs_quotes(tl_buffer name) {
+	size_t i;
+	const char *t;
+	if(!name.len) return 1;
+	for(i = 0; i < name.len; i++)
+		for(t = QUOTED_SYM_CHARS; *t; t++)
+			if(name.data[i] == *t)
+				return 1;
+	return 0;
 }
 
-void _print_pairs(tl_interp *in, tl_object *cur, size_t level) {
-	while(cur) {
-		if(in->disp_indent) {
-			tl_putc(in, '\n');
-			_indent(in, level);
-		}
-		if(!tl_is_pair(cur)) {
-			tl_printf(in, ". ");
-			_tl_print(in, cur, level);
-			cur = TL_EMPTY_LIST;
+/* What a printer stack frame does next */
+enum {
+	_TL_PRINT_OBJ,    /* Print obj */
+	_TL_PRINT_PAIRS,  /* Print the rest of a list, from obj (count items in) */
+	_TL_PRINT_CLOSE,  /* Close a list */
+	_TL_PRINT_SPACE,  /* Print a space */
+};
+
+struct _tl_print_frame {
+	int op;
+	tl_object *obj;
+	size_t level, count;
+};
+
+struct _tl_print_state {
+	const tl_print_opts *opts;
+	struct _tl_print_frame *stack, inline_stack[TL_PRINT_STACK_INLINE];
+	size_t len, sz;
+	/** With labels, 1 for objects seen once, 2 for those seen more often, and
+	 * 3 plus the label of those already printed.
+	 */
+	tl_ptrmap seen;
+	size_t next_label;
+};
+
+static void _tl_print_push(tl_interp *in, struct _tl_print_state *st, int op, tl_object *obj, size_t level, size_t count) {
+	struct _tl_print_frame *frame;
+	if(st->len == st->sz) {
+		st->sz *= 2;
+		if(st->stack == st->inline_stack) {
+			st->stack = tl_alloc_malloc(in, st->sz * sizeof(*st->stack));
+			assert(st->stack);
+			memcpy(st->stack, st->inline_stack, sizeof(st->inline_stack));
 		} else {
-			_tl_print(in, tl_first(cur), level);
-			if(tl_next(cur)) {
-				tl_printf(in, " ");
-			}
-			cur = tl_next(cur);
+			st->stack = tl_alloc_realloc(in, st->stack, st->sz * sizeof(*st->stack));
+			assert(st->stack);
 		}
 	}
+	frame = &st->stack[st->len++];
+	frame->op = op;
+	frame->obj = obj;
+	frame->level = level;
+	frame->count = count;
 }
 
-char *_mempbrk(char *m, char *s, size_t sz) {
-	size_t i;
-	char *t;
+/* Whether the printer descends into an object (and so might label it). */
+#define _tl_print_compound(obj) ((obj) && ((obj)->kind == TL_PAIR || (obj)->kind == TL_FUNC || (obj)->kind == TL_MACRO))
 
-	for(i = 0; i < sz; i++, m++)
-		for(t = s; *t; t++)
-			if(*m == *t)
-				return m;
-	return NULL;
+/* Count the references to every compound object reachable from obj, as far as
+ * the printer will go, so that shared ones can be labeled.
+ */
+static void _tl_print_scan(tl_interp *in, struct _tl_print_state *st, tl_object *obj) {
+	size_t *slot;
+	_tl_print_push(in, st, _TL_PRINT_OBJ, obj, 0, 0);
+	while(st->len) {
+		obj = st->stack[--st->len].obj;
+		if(!_tl_print_compound(obj)) continue;
+		slot = tl_ptrmap_slot(in, &st->seen, obj);
+		if(*slot) {
+			*slot = 2;
+			continue;
+		}
+		*slot = 1;
+		if(obj->kind == TL_PAIR) {
+			_tl_print_push(in, st, _TL_PRINT_OBJ, tl_next(obj), 0, 0);
+			_tl_print_push(in, st, _TL_PRINT_OBJ, tl_first(obj), 0, 0);
+		} else {
+			_tl_print_push(in, st, _TL_PRINT_OBJ, obj->body, 0, 0);
+			_tl_print_push(in, st, _TL_PRINT_OBJ, obj->envn, 0, 0);
+			_tl_print_push(in, st, _TL_PRINT_OBJ, obj->args, 0, 0);
+		}
+	}
 }
 
-tl_object *tl_print(tl_interp *in, tl_object *obj) {
-	return _tl_print(in, obj, 0);
+static void _tl_print_indent(tl_interp *in, size_t level) {
+	if(!in->disp_indent) return;
+	tl_putc(in, '\n');
+	while(level--) tl_putc(in, in->disp_indent);
 }
 
-tl_object *_tl_print(tl_interp *in, tl_object *obj, size_t level) {
-	tl_object *cur;
+/* Print an atom, or start on a compound object by pushing frames for the rest
+ * of it.
+ */
+static void _tl_print_obj(tl_interp *in, struct _tl_print_state *st, tl_object *obj, size_t level) {
+	size_t *slot;
 	if(!obj) {
 		tl_printf(in, "()");
-		return in->true_;
+		return;
+	}
+	if(_tl_print_compound(obj)) {
+		if(st->opts->max_depth && level >= st->opts->max_depth) {
+			tl_printf(in, "...");
+			return;
+		}
+		if(st->opts->labels && (slot = tl_ptrmap_slot(in, &st->seen, obj)) && *slot >= 2) {
+			if(*slot > 2) {
+				tl_printf(in, "#%ld#", (long)(*slot - 3));
+				return;
+			}
+			*slot = 3 + st->next_label;
+			tl_printf(in, "#%ld=", (long)st->next_label++);
+		}
 	}
 	switch(obj->kind) {
 		case TL_INT:
@@ -59,7 +138,7 @@ tl_object *_tl_print(tl_interp *in, tl_object *obj, size_t level) {
 			break;
 
 		case TL_SYM:
-			if(obj->nm->here.len == 0 || _mempbrk(obj->nm->here.data, QUOTED_SYM_CHARS, obj->nm->here.len)) {
+			if(obj->nm->quoted) {
 				tl_putc(in, '"');
 				tl_write(in, obj->nm->here.data, obj->nm->here.len);
 				tl_putc(in, '"');
@@ -70,40 +149,27 @@ tl_object *_tl_print(tl_interp *in, tl_object *obj, size_t level) {
 
 		case TL_PAIR:
 			tl_printf(in, "(");
-			_print_pairs(in, obj, level + 1);
-			if(in->disp_indent) {
-				tl_putc(in, '\n');
-				_indent(in, level);
-			}
-			tl_printf(in, ")");
+			_tl_print_push(in, st, _TL_PRINT_CLOSE, NULL, level, 0);
+			_tl_print_push(in, st, _TL_PRINT_PAIRS, obj, level + 1, 0);
 			break;
 
 		case TL_CFUNC:
 		case TL_CFUNC_BYVAL:
 		case TL_THEN:
-			tl_printf(in, "%s:%p", obj->name ? obj->name : (obj->kind == TL_CFUNC ? "<cfunc>" : (obj->kind == TL_CFUNC_BYVAL ? "<cfunc_byval>" : "<then>")), obj->cfunc);
-			/*if(obj->state) {
-				tl_printf(in, ":(");
-				tl_print(in, obj->state);
-				tl_printf(in, ")");
-			}*/
+			tl_printf(in, "%s:%p", obj->name ? obj->name : (obj->kind == TL_CFUNC ? "<cfunc>" : (obj->kind == TL_CFUNC_BYVAL ? "<cfunc_byval>" : "<then>")), obj->ent ? (void *) obj->ent->fnv : (void *) obj->cfunc);
 			break;
 
 		case TL_MACRO:
 		case TL_FUNC:
-			tl_printf(in, "(%s ", obj->kind == TL_MACRO ? "macro" : "lambda");
-			_tl_print(in, obj->args, level + 1);
-			tl_putc(in, ' ');
-			if(tl_is_macro(obj)) {
-				_tl_print(in, obj->envn, level + 1);
-				tl_putc(in, ' ');
-			}
-			_print_pairs(in, obj->body, level + 1);
-			if(in->disp_indent) {
-				tl_putc(in, '\n');
-				_indent(in, level);
+			tl_printf(in, "(%s ", tl_is_macro_pure(obj) ? "macro-pure" : (obj->kind == TL_MACRO ? "macro" : "lambda"));
+			_tl_print_push(in, st, _TL_PRINT_CLOSE, NULL, level, 0);
+			_tl_print_push(in, st, _TL_PRINT_PAIRS, obj->body, level + 1, 0);
+			if(tl_is_macro(obj) && !tl_is_macro_pure(obj)) {
+				_tl_print_push(in, st, _TL_PRINT_SPACE, NULL, 0, 0);
+				_tl_print_push(in, st, _TL_PRINT_OBJ, obj->envn, level + 1, 0);
 			}
-			tl_printf(in, ")");
+			_tl_print_push(in, st, _TL_PRINT_SPACE, NULL, 0, 0);
+			_tl_print_push(in, st, _TL_PRINT_OBJ, obj->args, level + 1, 0);
 			break;
 
 		case TL_CONT:
@@ -118,15 +184,134 @@ tl_object *_tl_print(tl_interp *in, tl_object *obj, size_t level) {
 			tl_printf(in, "<unknown object kind %d>", obj->kind);
 			break;
 	}
+}
+
+/* Print the next item of a list, leaving the frame to print the rest. */
+static void _tl_print_pairs(tl_interp *in, struct _tl_print_state *st) {
+	struct _tl_print_frame *frame = &st->stack[st->len - 1];
+	tl_object *cur = frame->obj;
+	size_t level = frame->level;
+	if(!cur) {
+		st->len--;
+		return;
+	}
+	if(frame->count) tl_putc(in, ' ');
+	_tl_print_indent(in, level);
+	if(st->opts->max_length && frame->count >= st->opts->max_length) {
+		tl_printf(in, "...");
+		st->len--;
+		return;
+	}
+	/* A labeled tail is printed as an improper one, so it can be referred to */
+	if(!tl_is_pair(cur) || (frame->count && st->opts->labels && tl_ptrmap_get(&st->seen, cur) >= 2)) {
+		tl_printf(in, ". ");
+		st->len--;
+		_tl_print_obj(in, st, cur, level);
+		return;
+	}
+	frame->obj = tl_next(cur);
+	frame->count++;
+	_tl_print_obj(in, st, tl_first(cur), level);
+}
+
+/** Print an object, with some options.
+ *
+ * This is `tl_print`, optionally labeling shared structure, and limiting the
+ * output; see ::tl_print_opts . The printer keeps its own stack, so deeply
+ * nested structures are printed without deep C recursion. A cyclic structure
+ * is printed forever, unless it is labeled or limited.
+ */
+tl_object *tl_print_with(tl_interp *in, tl_object *obj, const tl_print_opts *opts) {
+	struct _tl_print_state st;
+	struct _tl_print_frame *frame;
+	memset(&st, 0, sizeof(st));
+	st.opts = opts;
+	st.stack = st.inline_stack;
+	st.sz = TL_PRINT_STACK_INLINE;
+	if(opts->labels) _tl_print_scan(in, &st, obj);
+	_tl_print_obj(in, &st, obj, 0);
+	while(st.len) {
+		frame = &st.stack[st.len - 1];
+		switch(frame->op) {
+			case _TL_PRINT_OBJ:
+				st.len--;
+				_tl_print_obj(in, &st, frame->obj, frame->level);
+				break;
+
+			case _TL_PRINT_PAIRS:
+				_tl_print_pairs(in, &st);
+				break;
+
+			case _TL_PRINT_CLOSE:
+				st.len--;
+				_tl_print_indent(in, frame->level);
+				tl_printf(in, ")");
+				break;
+
+			case _TL_PRINT_SPACE:
+				st.len--;
+				tl_putc(in, ' ');
+				break;
+		}
+	}
+	if(st.stack != st.inline_stack) tl_alloc_free(in, st.stack);
+	tl_ptrmap_free(in, &st.seen);
 	return in->true_;
 }
 
+/** Print an object, in the syntax `tl_read` reads, with tl_interp::print_opts . */
+tl_object *tl_print(tl_interp *in, tl_object *obj) {
+	return tl_print_with(in, obj, &in->print_opts);
+}
+
+/** Hand buffered output to tl_interp::writebuf .
+ *
+ * Output is otherwise only flushed when the buffer fills, at the end of a
+ * line if tl_interp::flush_lines is set, and by `tl_interp_cleanup`; hosts
+ * should call this whenever the output should be seen, like before waiting
+ * for input. This does nothing for unbuffered interpreters.
+ */
+void tl_flush(tl_interp *in) {
+	if(in->output_len && in->writebuf) in->writebuf(in, in->output_buf, in->output_len);
+	in->output_len = 0;
+}
+
+/* Append to the output buffer, flushing as needed. */
+static void _tl_write_buffered(tl_interp *in, const char *data, size_t len) {
+	size_t n, i;
+	int nl;
+	if(!in->output_buf && !(in->output_buf = tl_alloc_malloc(in, TL_OUTPUT_BUFFER_SIZE))) {
+		/* Unbuffered, then */
+		in->writebuf(in, data, len);
+		return;
+	}
+	while(len) {
+		n = TL_OUTPUT_BUFFER_SIZE - in->output_len;
+		if(n > len) n = len;
+		memcpy(in->output_buf + in->output_len, data, n);
+		in->output_len += n;
+		for(i = 0, nl = 0; in->flush_lines && !nl && i < n; i++) nl = data[i] == '\n';
+		if(in->output_len == TL_OUTPUT_BUFFER_SIZE || nl) tl_flush(in);
+		data += n;
+		len -= n;
+	}
+}
+
+/** Buffer a character for tl_interp::writebuf ; this implements `tl_putc`. */
+void _tl_putc_buffered(tl_interp *in, char c) {
+	_tl_write_buffered(in, &c, 1);
+}
+
 void tl_puts(tl_interp *in, const char *s) {
-	while(*s != 0) tl_putc(in, *s++);
+	tl_write(in, s, strlen(s));
 }
 
 void tl_write(tl_interp *in, const char *data, size_t len) {
 	size_t i = 0;
+	if(in->writebuf) {
+		_tl_write_buffered(in, data, len);
+		return;
+	}
 	while(i++ < len) tl_putc(in, *data++);
 }
 
@@ -137,10 +322,15 @@ void tl_printf(tl_interp *in, const char *cur, ...) {
 		tl_buffer *b;
 	} temp;
 	char buf[32];
+	size_t len;
 
 	va_start(ap, cur);
 	while(*cur != 0) {
-		if(*cur == '%') {
+		if(*cur != '%') {
+			for(len = 1; cur[len] && cur[len] != '%'; len++);
+			tl_write(in, cur, len);
+			cur += len;
+		} else {
 			cur++;
 			switch(*cur) {
 				case 0:
@@ -204,8 +394,6 @@ void tl_printf(tl_interp *in, const char *cur, ...) {
 					tl_putc(in, *cur++);
 					break;
 			}
-		} else {
-			tl_putc(in, *cur++);
 		}
 	}
 
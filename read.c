@@ -1,4 +1,5 @@
 #include <stdlib.h>
+#include <string.h>
 #include <ctype.h>
 #include <assert.h>
 
@@ -13,6 +14,20 @@
 #define DEFAULT_SYM_LEN 64
 #endif
 
+#define _tl_build_str(x) #x
+#define _tl_build_xstr(x) _tl_build_str(x)
+
+/** Identify this build of the reader, for caches of what it reads.
+ *
+ * Anything that keeps forms read by one build for another (like the form cache
+ * in main.c) should treat different strings as different readers. The string
+ * only depends on ::TL_READER_VERSION and ::TL_FORM_VERSION , so rebuilding
+ * the same sources keeps such caches valid.
+ */
+const char *tl_build_id(void) {
+	return "reader " _tl_build_xstr(TL_READER_VERSION) " forms " _tl_build_xstr(TL_FORM_VERSION);
+}
+
 /** A helper macro to return a TL_SYM from a C string which was allocated using malloc(). */
 #define return_sym_from_buf(in, s, sz) do { \
 	tl_object *ret = tl_new_sym_data((in), (s), (sz)); \
@@ -64,6 +79,276 @@ reader_proto(sym);
 	} \
 } while(0)
 
+#ifndef TL_READ_FAST_DEPTH
+/** The deepest nesting of lists `tl_read` parses straight out of
+ * tl_interp::input_buf .
+ *
+ * The direct parser recurses on the C stack, so this bounds its use of it;
+ * a deeper form is read by the character-at-a-time reader instead.
+ */
+#define TL_READ_FAST_DEPTH 256
+#endif
+
+/** Find the value of the prefix (see `tl-prefix`) starting with `ch`, or NULL. */
+static tl_object *_tl_read_prefix(tl_interp *in, int ch) {
+	for(tl_list_iter(in->prefixes, kv)) {
+		tl_object *k = tl_first(kv);
+		tl_object *v = tl_next(kv);
+		if(k && v && tl_is_sym(k) && k->nm->here.len > 0 && k->nm->here.data[0] == ch) {
+			return v;
+		}
+	}
+	return NULL;
+}
+
+/** Parse a form from tl_interp::input_buf , starting at `*pos`.
+ *
+ * This reads exactly what the reader continuations below would, given the
+ * same characters, but without a step (and a THEN) per character. It returns
+ * 1, with the form in `*form` and `*pos` just past it, if the buffered input
+ * decides the form; otherwise (the form runs to the end of the buffer, nests
+ * more than ::TL_READ_FAST_DEPTH deep, or is otherwise unusual), it returns 0,
+ * and the form is left to the continuations. Either way, nothing is consumed
+ * from the input, and no error is raised.
+ */
+static int _tl_read_fast(tl_interp *in, size_t *pos, int depth, tl_object **form) {
+	const char *buf = in->input_buf;
+	size_t i = *pos, end = in->input_len, j;
+	tl_object *head = TL_EMPTY_LIST, *tail = TL_EMPTY_LIST, *item, *prefix;
+	long ival;
+	int ch;
+
+	for(;;) {
+		if(i >= end) return 0;
+		ch = (unsigned char)buf[i];
+		if(is_any_ws(ch)) {
+			i++;
+		} else if(ch == ';') {
+			while(i < end && buf[i] != '\n') i++;
+			if(i++ >= end) return 0;
+		} else {
+			break;
+		}
+	}
+
+	switch(ch) {
+		case '"':
+			for(j = ++i; j < end && buf[j] != '"'; j++);
+			if(j >= end) return 0;
+			*form = tl_new_sym_data(in, buf + i, j - i);
+			*pos = j + 1;
+			return 1;
+
+		case '(':
+			if(depth >= TL_READ_FAST_DEPTH) return 0;
+			i++;
+			for(;;) {
+				while(i < end && is_any_ws((unsigned char)buf[i])) i++;
+				if(i >= end) return 0;
+				if(buf[i] == ')') {
+					*form = head;
+					*pos = i + 1;
+					return 1;
+				}
+				if(buf[i] == '.') {
+					/* Only the usual (a b . c) is read here */
+					i++;
+					if(!head || !_tl_read_fast(in, &i, depth + 1, &item)) return 0;
+					while(i < end && is_any_ws((unsigned char)buf[i])) i++;
+					if(i >= end || buf[i] != ')') return 0;
+					tail->next = item;
+					*form = head;
+					*pos = i + 1;
+					return 1;
+				}
+				if(!_tl_read_fast(in, &i, depth + 1, &item)) return 0;
+				item = tl_new_pair(in, item, TL_EMPTY_LIST);
+				if(head) {
+					tail->next = item;
+				} else {
+					head = item;
+				}
+				tail = item;
+			}
+
+		default:
+			if(isdigit(ch)) {
+				for(ival = 0; i < end && isdigit((unsigned char)buf[i]); i++) ival = ival * 10 + (buf[i] - '0');
+				if(i >= end) return 0;
+				*form = tl_new_int(in, ival);
+				*pos = i;
+				return 1;
+			}
+			if((prefix = _tl_read_prefix(in, ch))) {
+				i++;
+				if(depth >= TL_READ_FAST_DEPTH || !_tl_read_fast(in, &i, depth + 1, &item)) return 0;
+				*form = tl_new_pair(in, prefix, tl_new_pair(in, item, TL_EMPTY_LIST));
+				*pos = i;
+				return 1;
+			}
+			for(j = i; j < end && buf[j] != '(' && buf[j] != ')' && !is_any_ws((unsigned char)buf[j]); j++);
+			if(j >= end) return 0;
+			*form = tl_new_sym_data(in, buf + i, j - i);
+			*pos = j;
+			return 1;
+	}
+}
+
+/** Get the first character of the next chunk from tl_interp::readbuf .
+ *
+ * This is how `tl_getc` reads once tl_interp::input_buf runs out, if there
+ * is a tl_interp::readbuf ; it returns `EOF` at the end of input.
+ */
+int _tl_getc_refill(tl_interp *in) {
+	const char *data;
+	size_t len;
+	if(!in->readbuf(in, &data, &len) || !len) return EOF;
+	in->input_buf = data;
+	in->input_len = len;
+	in->input_pos = 1;
+	return (unsigned char)data[0];
+}
+
+/* Character classes for tl_read_split, in the order the reader tests them */
+enum {
+	_TL_SPLIT_OTHER,
+	_TL_SPLIT_WS,
+	_TL_SPLIT_COMMENT,
+	_TL_SPLIT_STRING,
+	_TL_SPLIT_OPEN,
+	_TL_SPLIT_CLOSE,
+	_TL_SPLIT_DIGIT,
+	_TL_SPLIT_PREFIX,
+};
+
+#define _TL_WORD_ONES ((size_t)-1 / 0xff)
+#define _TL_WORD_HIGHS (_TL_WORD_ONES * 0x80)
+
+/* Find the first `c` in text[i..len), or len, a word at a time. */
+static size_t _tl_read_find(const char *text, size_t i, size_t len, char c) {
+	size_t word, pat = _TL_WORD_ONES * (unsigned char)c;
+	for(; i + sizeof(word) <= len; i += sizeof(word)) {
+		memcpy(&word, text + i, sizeof(word));
+		word ^= pat;
+		/* Nonzero iff some byte of the word is zero, i.e. was `c` */
+		if((word - _TL_WORD_ONES) & ~word & _TL_WORD_HIGHS) break;
+	}
+	for(; i < len && text[i] != c; i++);
+	return i;
+}
+
+/** Split some text into `n` runs of whole top-level forms, to read separately.
+ *
+ * This follows the reader (with the interpreter's current prefixes) just far
+ * enough to find where each top-level form ends, honoring strings, comments,
+ * and nesting, without building anything. Run `i` is the text from `cuts[i]`
+ * to `cuts[i + 1]`, holding `forms[i]` forms (so `cuts` has room for `n + 1`
+ * offsets); the runs are about equally long, though some may be empty.
+ *
+ * The end of the text is the end of input, as it would be to the reader. The
+ * runs end early--before a form left unfinished at the end, or a stray `)`--
+ * so that each can be read on its own; the return value (also `cuts[n]`) is
+ * the length of the text they cover.
+ */
+size_t tl_read_split(tl_interp *in, const char *text, size_t len, size_t n, size_t *cuts, size_t *forms) {
+	unsigned char cls[256];
+	size_t i = 0, j, depth = 0, run = 0, count = 0, done = 0;
+	/* Whether the top reader (rather than a list's) reads the next character,
+	 * and whether a prefix at top level is waiting for its form
+	 */
+	int top = 1, prefixed = 0, ch;
+
+	memset(cls, _TL_SPLIT_OTHER, sizeof(cls));
+	cls[' '] = cls['\n'] = cls['\t'] = cls['\v'] = cls['\r'] = cls['\b'] = _TL_SPLIT_WS;
+	cls[';'] = _TL_SPLIT_COMMENT;
+	cls['"'] = _TL_SPLIT_STRING;
+	cls['('] = _TL_SPLIT_OPEN;
+	cls[')'] = _TL_SPLIT_CLOSE;
+	for(ch = '0'; ch <= '9'; ch++) cls[ch] = _TL_SPLIT_DIGIT;
+	for(tl_list_iter(in->prefixes, kv)) {
+		tl_object *k = tl_first(kv);
+		if(k && tl_next(kv) && tl_is_sym(k) && k->nm->here.len > 0 && cls[(unsigned char)k->nm->here.data[0]] == _TL_SPLIT_OTHER) {
+			cls[(unsigned char)k->nm->here.data[0]] = _TL_SPLIT_PREFIX;
+		}
+	}
+
+	cuts[0] = 0;
+	while(i < len) {
+		ch = (unsigned char)text[i];
+		switch(cls[ch]) {
+			case _TL_SPLIT_WS:
+				i++;
+				continue;
+
+			case _TL_SPLIT_COMMENT:
+				i = _tl_read_find(text, i, len, '\n') + 1;
+				top = 1;
+				continue;
+
+			case _TL_SPLIT_STRING:
+				if((j = _tl_read_find(text, i + 1, len, '"')) >= len) goto end;
+				i = j + 1;
+				break;
+
+			case _TL_SPLIT_OPEN:
+				depth++;
+				top = 0;
+				i++;
+				continue;
+
+			case _TL_SPLIT_CLOSE:
+				/* (After an empty symbol, if the top reader has it) */
+				if(!depth) goto end;
+				depth--;
+				i++;
+				break;
+
+			case _TL_SPLIT_DIGIT:
+				while(++i < len && isdigit((unsigned char)text[i]));
+				break;
+
+			case _TL_SPLIT_PREFIX:
+				if(!top && ch == '.') goto dot;
+				i++;
+				top = 1;
+				if(!depth) prefixed = 1;
+				continue;
+
+			default:
+				if(depth && !top && ch == '.') {
+dot:
+					/* The tail of an improper list follows */
+					i++;
+					top = 1;
+					continue;
+				}
+				while(++i < len && cls[(unsigned char)text[i]] != _TL_SPLIT_WS && cls[(unsigned char)text[i]] != _TL_SPLIT_OPEN && cls[(unsigned char)text[i]] != _TL_SPLIT_CLOSE);
+				break;
+		}
+		/* An item ended at i */
+		top = 0;
+		if(depth) continue;
+		top = 1;
+		prefixed = 0;
+		count++;
+		done = i;
+		if(run + 1 < n && done >= len / n * (run + 1)) {
+			forms[run++] = count;
+			cuts[run] = done;
+			count = 0;
+		}
+	}
+	/* Only whitespace and comments follow the last form, if nothing's open */
+	if(!depth && !prefixed) done = len;
+end:
+	forms[run] = count;
+	while(run < n) {
+		cuts[++run] = done;
+		if(run < n) forms[run] = 0;
+	}
+	return done;
+}
+
 /* FIXME: NULL and TL_EMPTY_LIST are the same; empty list can signal EOF */
 /** Read a value, as a coroutine.
  *
@@ -78,6 +363,13 @@ reader_proto(sym);
  * However, it also means that `tl-read` from user code does what one expects.
  */
 void tl_read(tl_interp *in) {
+	size_t pos = in->input_pos;
+	tl_object *form;
+	if(!in->is_putback && pos < in->input_len && _tl_read_fast(in, &pos, 0, &form)) {
+		in->input_pos = pos;
+		tl_values_push(in, form);
+		return;
+	}
 	tl_getc_and_then(in, TL_EMPTY_LIST, _tl_read_top_k);
 }
 
@@ -87,6 +379,7 @@ static void _tl_read_top_prefix_k(tl_interp *in, tl_object *args, tl_object *sta
 }
 
 reader(top) {
+	tl_object *prefix;
 	reader_prologue(in, args);
 	switch(ch) {
 		case EOF:
@@ -114,17 +407,13 @@ reader(top) {
 				tl_getc_and_then(in, tl_new_int(in, ch - '0'), _tl_read_int_k);
 				return;
 			}
-			for(tl_list_iter(in->prefixes, kv)) {
-				tl_object *k = tl_first(kv);
-				tl_object *v = tl_next(kv);
-				if(k && v && tl_is_sym(k) && k->nm->here.len > 0 && k->nm->here.data[0] == ch) {
-					tl_push_apply(in, 1,
-							tl_new_then(in, _tl_read_top_prefix_k, v, "_tl_read_top_k<prefix>"),
-							in->env
-					);
-					tl_getc_and_then(in, TL_EMPTY_LIST, _tl_read_top_k);
-					return;
-				}
+			if((prefix = _tl_read_prefix(in, ch))) {
+				tl_push_apply(in, 1,
+						tl_new_then(in, _tl_read_top_prefix_k, prefix, "_tl_read_top_k<prefix>"),
+						in->env
+				);
+				tl_getc_and_then(in, TL_EMPTY_LIST, _tl_read_top_k);
+				return;
 			}
 			tl_putback(in, ch);
 			tl_getc_and_then(in, state, _tl_read_sym_k);
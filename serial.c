@@ -0,0 +1,481 @@
+#include <string.h>
+#include <stdio.h>
+#include <assert.h>
+
+#include "tinylisp.h"
+
+/* Encoded forms are a portable byte stream (independent of word size and
+ * endianness), used to ship code that has already been through the reader:
+ *
+ * - the magic "TLF" and a version byte;
+ * - then each form, in order, as one item, until the end of the data.
+ *
+ * An item is a tag byte, possibly followed by unsigned LEB128 numbers (`u`):
+ *
+ * - 'n': the empty list;
+ * - 'i' u: an integer, zigzag-encoded (so small negatives stay small);
+ * - 's' u bytes: a symbol with a u-byte name, which gets the next index in the
+ *   stream's symbol table (starting at 0);
+ * - 'y' u: the symbol at index u of the table;
+ * - 'l' u items... item: a list of u (at least one) elements, followed by its
+ *   tail (usually 'n');
+ * - 'd' 'l' ...: a list whose first pair gets the next index in the form's
+ *   table of shared pairs (starting at 0 for each form), so that it can be
+ *   referred to, even from within itself;
+ * - 'r' u: the shared pair at index u of the table.
+ *
+ * Only integers, symbols, and pairs are encodable. The encoder writes 'd' and
+ * 'r' only when asked to (see tl_form_writer::shared), in which case a shared
+ * pair always starts a list, ending the run of the list it is the tail of.
+ *
+ * In place of a form, a stream may also have 'a' u bytes u bytes: a definition
+ * to autoload (see ::tl_autoload), with the name it defines, and a complete
+ * stream (with its own header and symbol table) of the forms defining it.
+ */
+
+#define TL_FORM_MAGIC "TLF"
+
+static size_t _tl_ptrmap_hash(const void *p, size_t cap) {
+	size_t h = (size_t)p;
+	h ^= h >> 17;
+	h *= (size_t)0x9E3779B97F4A7C15ULL;
+	return (h ^ (h >> 29)) & (cap - 1);
+}
+
+/** Find the value slot of a key in a pointer map, adding it if needed.
+ *
+ * Returns a pointer to the slot, in which 0 means "absent" (as it is for a
+ * newly added key); the caller stores a nonzero value there to keep it. The
+ * pointer is only valid until the next call on the same map.
+ */
+size_t *tl_ptrmap_slot(tl_interp *in, tl_ptrmap *map, const void *key) {
+	size_t i;
+	if((map->len + 1) * 2 > map->cap) {
+		tl_ptrmap grown = { NULL, NULL, map->cap ? map->cap * 2 : 256, 0 };
+		grown.keys = tl_alloc_malloc(in, grown.cap * sizeof(*grown.keys));
+		grown.vals = tl_alloc_malloc(in, grown.cap * sizeof(*grown.vals));
+		assert(grown.keys && grown.vals);
+		memset(grown.keys, 0, grown.cap * sizeof(*grown.keys));
+		for(i = 0; i < map->cap; i++) {
+			if(map->keys[i]) *tl_ptrmap_slot(in, &grown, map->keys[i]) = map->vals[i];
+		}
+		tl_alloc_free(in, map->keys);
+		tl_alloc_free(in, map->vals);
+		*map = grown;
+	}
+	for(i = _tl_ptrmap_hash(key, map->cap); map->keys[i]; i = (i + 1) & (map->cap - 1)) {
+		if(map->keys[i] == key) return &map->vals[i];
+	}
+	map->keys[i] = key;
+	map->vals[i] = 0;
+	map->len++;
+	return &map->vals[i];
+}
+
+/** Look up a key in a pointer map without adding it, returning 0 if absent. */
+size_t tl_ptrmap_get(const tl_ptrmap *map, const void *key) {
+	size_t i;
+	if(!map->cap) return 0;
+	for(i = _tl_ptrmap_hash(key, map->cap); map->keys[i]; i = (i + 1) & (map->cap - 1)) {
+		if(map->keys[i] == key) return map->vals[i];
+	}
+	return 0;
+}
+
+/** Free the storage of a pointer map, leaving it empty. */
+void tl_ptrmap_free(tl_interp *in, tl_ptrmap *map) {
+	tl_alloc_free(in, map->keys);
+	tl_alloc_free(in, map->vals);
+	memset(map, 0, sizeof(*map));
+}
+
+/* Write out what's been encoded so far, if the writer has a file. */
+static void _tl_form_flush(tl_form_writer *w) {
+	if(!w->file) return;
+	fwrite(w->data, 1, w->len, w->file);
+	w->len = 0;
+}
+
+static void _tl_form_put(tl_interp *in, tl_form_writer *w, const void *data, size_t len) {
+	if(w->len + len > w->sz) {
+		while(w->len + len > w->sz) w->sz = (w->sz << 1) | 4095;
+		w->data = tl_alloc_realloc(in, w->data, w->sz);
+		assert(w->data);
+	}
+	memcpy(w->data + w->len, data, len);
+	w->len += len;
+}
+
+static void _tl_form_put_tag(tl_interp *in, tl_form_writer *w, char tag) {
+	_tl_form_put(in, w, &tag, 1);
+}
+
+static void _tl_form_put_uleb(tl_interp *in, tl_form_writer *w, unsigned long n) {
+	unsigned char buf[sizeof(n) * 8 / 7 + 1];
+	size_t len = 0;
+	do {
+		buf[len] = n & 0x7f;
+		n >>= 7;
+		if(n) buf[len] |= 0x80;
+		len++;
+	} while(n);
+	_tl_form_put(in, w, buf, len);
+}
+
+/* Count the references to each pair of a form, to find the shared ones. */
+static void _tl_form_scan(tl_interp *in, tl_form_writer *w, tl_object *obj) {
+	size_t *slot;
+	for(; obj && tl_is_pair(obj); obj = tl_next(obj)) {
+		slot = tl_ptrmap_slot(in, &w->seen, obj);
+		if(*slot) {
+			*slot = 2;
+			return;
+		}
+		*slot = 1;
+		_tl_form_scan(in, w, tl_first(obj));
+	}
+}
+
+/* Whether a pair continues the run of a list, rather than being its tail. */
+static int _tl_form_in_run(tl_form_writer *w, tl_object *cell) {
+	if(!cell || !tl_is_pair(cell)) return 0;
+	return !w->shared || tl_ptrmap_get(&w->seen, cell) < 2;
+}
+
+static int _tl_form_encode(tl_interp *in, tl_form_writer *w, tl_object *obj) {
+	size_t *slot, count;
+	tl_object *tail;
+	if(!obj) {
+		_tl_form_put_tag(in, w, 'n');
+		return 1;
+	}
+	switch(obj->kind) {
+		case TL_INT:
+			_tl_form_put_tag(in, w, 'i');
+			_tl_form_put_uleb(in, w, ((unsigned long)obj->ival << 1) ^ (unsigned long)(obj->ival < 0 ? -1L : 0L));
+			return 1;
+
+		case TL_SYM:
+			slot = tl_ptrmap_slot(in, &w->names, obj->nm);
+			if(*slot) {
+				_tl_form_put_tag(in, w, 'y');
+				_tl_form_put_uleb(in, w, *slot - 1);
+			} else {
+				*slot = ++w->nnames;
+				_tl_form_put_tag(in, w, 's');
+				_tl_form_put_uleb(in, w, obj->nm->here.len);
+				_tl_form_put(in, w, obj->nm->here.data, obj->nm->here.len);
+			}
+			return 1;
+
+		case TL_PAIR:
+			if(w->shared) {
+				slot = tl_ptrmap_slot(in, &w->seen, obj);
+				if(*slot > 2) {
+					_tl_form_put_tag(in, w, 'r');
+					_tl_form_put_uleb(in, w, *slot - 3);
+					return 1;
+				}
+				if(*slot == 2) {
+					*slot = 3 + w->nshared++;
+					_tl_form_put_tag(in, w, 'd');
+				}
+			}
+			count = 1;
+			for(tail = tl_next(obj); _tl_form_in_run(w, tail); tail = tl_next(tail)) count++;
+			_tl_form_put_tag(in, w, 'l');
+			_tl_form_put_uleb(in, w, count);
+			for(tail = obj; count--; tail = tl_next(tail)) {
+				if(!_tl_form_encode(in, w, tl_first(tail))) return 0;
+			}
+			return _tl_form_encode(in, w, tail);
+
+		default:
+			return 0;
+	}
+}
+
+/** Initialize an encoder for ::tl_form_encode , writing the stream header. */
+void tl_form_writer_init(tl_interp *in, tl_form_writer *w) {
+	static const char hdr[] = { TL_FORM_MAGIC[0], TL_FORM_MAGIC[1], TL_FORM_MAGIC[2], TL_FORM_VERSION };
+	memset(w, 0, sizeof(*w));
+	_tl_form_put(in, w, hdr, sizeof(hdr));
+}
+
+/** Initialize an encoder that writes each form to `file` as it is encoded.
+ *
+ * The file stays the caller's, and the stream header is written right away.
+ * Check `ferror(file)` for write errors.
+ */
+void tl_form_writer_init_file(tl_interp *in, tl_form_writer *w, FILE *file) {
+	tl_form_writer_init(in, w);
+	w->file = file;
+	_tl_form_flush(w);
+}
+
+/** Append a form to an encoded stream.
+ *
+ * Returns 0 (leaving the stream unchanged) if the form has anything but
+ * integers, symbols, and pairs in it, and nonzero otherwise. The stream is in
+ * tl_form_writer::data , with length tl_form_writer::len , unless it's written
+ * to tl_form_writer::file .
+ *
+ * Unless tl_form_writer::shared is set, structure reachable more than once is
+ * written out again each time, and a cyclic form never finishes encoding.
+ */
+int tl_form_encode(tl_interp *in, tl_form_writer *w, tl_object *form) {
+	size_t len = w->len, nnames = w->nnames;
+	int ok;
+	if(w->shared) _tl_form_scan(in, w, form);
+	ok = _tl_form_encode(in, w, form);
+	if(w->shared) {
+		tl_ptrmap_free(in, &w->seen);
+		w->nshared = 0;
+	}
+	if(ok) {
+		_tl_form_flush(w);
+		return 1;
+	}
+	/* Forget the symbols introduced by the failed form */
+	for(size_t i = 0; i < w->names.cap; i++) {
+		if(w->names.keys[i] && w->names.vals[i] > nnames) w->names.vals[i] = 0;
+	}
+	w->len = len;
+	w->nnames = nnames;
+	return 0;
+}
+
+/** Append a definition of `name` to autoload to an encoded stream.
+ *
+ * Decoding the stream registers `form` (usually a `define` of `name`) with
+ * ::tl_autoload , to be evaluated the first time `name` is referenced while
+ * unbound, instead of decoding it as the next form. The caller decides
+ * whether deferring `form` is safe; it shouldn't have any other effects.
+ * Returns 0 (leaving the stream unchanged) if the form isn't encodable.
+ */
+int tl_form_encode_autoload(tl_interp *in, tl_form_writer *w, tl_name *name, tl_object *form) {
+	tl_form_writer def;
+	tl_form_writer_init(in, &def);
+	if(!tl_form_encode(in, &def, form)) {
+		tl_form_writer_free(in, &def);
+		return 0;
+	}
+	_tl_form_put_tag(in, w, 'a');
+	_tl_form_put_uleb(in, w, name->here.len);
+	_tl_form_put(in, w, name->here.data, name->here.len);
+	_tl_form_put_uleb(in, w, def.len);
+	_tl_form_put(in, w, def.data, def.len);
+	tl_form_writer_free(in, &def);
+	_tl_form_flush(w);
+	return 1;
+}
+
+/** Free an encoder's storage, including tl_form_writer::data . */
+void tl_form_writer_free(tl_interp *in, tl_form_writer *w) {
+	tl_alloc_free(in, w->data);
+	tl_ptrmap_free(in, &w->names);
+	tl_ptrmap_free(in, &w->seen);
+	memset(w, 0, sizeof(*w));
+}
+
+/** Initialize a decoder for ::tl_form_decode over `len` bytes at `data`.
+ *
+ * The data must stay valid while the decoder is used, and, if the stream has
+ * definitions to autoload, as long as the interpreter may load them. Returns 0
+ * if the data doesn't start with a stream header, and nonzero otherwise.
+ */
+int tl_form_reader_init(tl_form_reader *r, const void *data, size_t len) {
+	memset(r, 0, sizeof(*r));
+	r->pos = data;
+	r->end = r->pos + len;
+	if(len < 4 || memcmp(r->pos, TL_FORM_MAGIC, 3) || r->pos[3] != TL_FORM_VERSION) {
+		r->pos = r->end;
+		return 0;
+	}
+	r->pos += 4;
+	return 1;
+}
+
+/* Make at least n bytes available at r->pos , reading them from the file if
+ * the decoder has one; returns 0 if there aren't that many.
+ */
+static int _tl_form_need(tl_interp *in, tl_form_reader *r, size_t n) {
+	size_t have = r->end - r->pos, sz;
+	unsigned char *buf;
+	if(have >= n) return 1;
+	if(!r->file) return 0;
+	if(n > r->sz) {
+		for(sz = r->sz; sz < n; sz <<= 1);
+		buf = tl_alloc_realloc(in, r->buf, sz);
+		if(!buf) return 0;
+		r->pos = buf + (r->pos - r->buf);
+		r->buf = buf;
+		r->sz = sz;
+	}
+	memmove(r->buf, r->pos, have);
+	r->pos = r->buf;
+	/* Read no further than needed, so the file can hold other data after */
+	r->end = r->buf + have + fread(r->buf + have, 1, n - have, r->file);
+	return (size_t)(r->end - r->pos) >= n;
+}
+
+/** Initialize a decoder for ::tl_form_decode reading a stream from `file`.
+ *
+ * The decoder reads only as much as it decodes, so a stream can be followed
+ * by other data. Its definitions to autoload are treated as malformed. The
+ * file stays the caller's. Returns 0 if the file doesn't start with a stream
+ * header, and nonzero otherwise.
+ */
+int tl_form_reader_init_file(tl_interp *in, tl_form_reader *r, FILE *file) {
+	memset(r, 0, sizeof(*r));
+	r->sz = 256;
+	r->buf = tl_alloc_malloc(in, r->sz);
+	assert(r->buf);
+	r->pos = r->end = r->buf;
+	r->file = file;
+	if(!_tl_form_need(in, r, 4) || memcmp(r->pos, TL_FORM_MAGIC, 3) || r->pos[3] != TL_FORM_VERSION) {
+		r->file = NULL;
+		r->pos = r->end;
+		return 0;
+	}
+	r->pos += 4;
+	return 1;
+}
+
+static int _tl_form_get_uleb(tl_interp *in, tl_form_reader *r, unsigned long *n) {
+	unsigned shift = 0;
+	*n = 0;
+	while(_tl_form_need(in, r, 1) && shift < sizeof(*n) * 8) {
+		unsigned char b = *r->pos++;
+		*n |= (unsigned long)(b & 0x7f) << shift;
+		if(!(b & 0x80)) return 1;
+		shift += 7;
+	}
+	return 0;
+}
+
+static int _tl_form_decode(tl_interp *, tl_form_reader *, tl_object **);
+
+/* Decode a list (just after its 'l'), sharing its first pair if `define`. */
+static int _tl_form_decode_list(tl_interp *in, tl_form_reader *r, tl_object **out, int define) {
+	unsigned long n;
+	tl_object *head = NULL, *last = NULL, *cell;
+	if(!_tl_form_get_uleb(in, r, &n) || !n) return 0;
+	while(n--) {
+		cell = tl_new_pair(in, NULL, TL_EMPTY_LIST);
+		if(last) {
+			last->next = cell;
+		} else {
+			head = cell;
+			if(define) {
+				if(r->nshared >= r->szshared) {
+					r->szshared = (r->szshared << 1) | 15;
+					r->shared = tl_alloc_realloc(in, r->shared, r->szshared * sizeof(*r->shared));
+					assert(r->shared);
+				}
+				r->shared[r->nshared++] = head;
+			}
+		}
+		last = cell;
+		if(!_tl_form_decode(in, r, &cell->first)) return 0;
+	}
+	if(!_tl_form_decode(in, r, &last->next)) return 0;
+	*out = head;
+	return 1;
+}
+
+static int _tl_form_decode(tl_interp *in, tl_form_reader *r, tl_object **out) {
+	unsigned long n;
+	tl_buffer buf;
+
+	if(!_tl_form_need(in, r, 1)) return 0;
+	switch(*r->pos++) {
+		case 'n':
+			*out = TL_EMPTY_LIST;
+			return 1;
+
+		case 'i':
+			if(!_tl_form_get_uleb(in, r, &n)) return 0;
+			*out = tl_new_int(in, (long)(n >> 1) ^ -(long)(n & 1));
+			return 1;
+
+		case 's':
+			if(!_tl_form_get_uleb(in, r, &n) || !_tl_form_need(in, r, n)) return 0;
+			buf.data = (char *)r->pos;
+			buf.len = n;
+			r->pos += n;
+			if(r->nnames >= r->sznames) {
+				r->sznames = (r->sznames << 1) | 63;
+				r->names = tl_alloc_realloc(in, r->names, r->sznames * sizeof(*r->names));
+				assert(r->names);
+			}
+			r->names[r->nnames++] = tl_ns_resolve(in, &in->ns, buf);
+			*out = tl_new_sym_name(in, r->names[r->nnames - 1]);
+			return 1;
+
+		case 'y':
+			if(!_tl_form_get_uleb(in, r, &n) || n >= r->nnames) return 0;
+			*out = tl_new_sym_name(in, r->names[n]);
+			return 1;
+
+		case 'l':
+			return _tl_form_decode_list(in, r, out, 0);
+
+		case 'd':
+			if(!_tl_form_need(in, r, 1) || *r->pos++ != 'l') return 0;
+			return _tl_form_decode_list(in, r, out, 1);
+
+		case 'r':
+			if(!_tl_form_get_uleb(in, r, &n) || n >= r->nshared) return 0;
+			*out = r->shared[n];
+			return 1;
+
+		default:
+			return 0;
+	}
+}
+
+/* Register the autoload definition at r->pos (just after its tag). */
+static int _tl_form_autoload(tl_interp *in, tl_form_reader *r) {
+	unsigned long n;
+	tl_buffer name;
+	if(r->file) return 0;
+	if(!_tl_form_get_uleb(in, r, &n) || n > (unsigned long)(r->end - r->pos)) return 0;
+	name.data = (char *)r->pos;
+	name.len = n;
+	r->pos += n;
+	if(!_tl_form_get_uleb(in, r, &n) || n > (unsigned long)(r->end - r->pos)) return 0;
+	tl_autoload(in, tl_ns_resolve(in, &in->ns, name), r->pos, n);
+	r->pos += n;
+	return 1;
+}
+
+/** Decode the next form of a stream into `*form` .
+ *
+ * Definitions to autoload along the way are registered with ::tl_autoload .
+ * Returns 1 when a form was decoded, 0 at the end of the data, and -1 if the
+ * data is malformed (after which the decoder is at its end). Nothing here runs
+ * the collector, but the caller must keep each form reachable itself before
+ * anything else may.
+ */
+int tl_form_decode(tl_interp *in, tl_form_reader *r, tl_object **form) {
+	while(_tl_form_need(in, r, 1) && *r->pos == 'a') {
+		r->pos++;
+		if(!_tl_form_autoload(in, r)) goto bad;
+	}
+	if(!_tl_form_need(in, r, 1)) return 0;
+	r->nshared = 0;
+	if(_tl_form_decode(in, r, form)) return 1;
+bad:
+	r->file = NULL;
+	r->pos = r->end;
+	return -1;
+}
+
+/** Free a decoder's tables (and buffer, if it reads a file). */
+void tl_form_reader_free(tl_interp *in, tl_form_reader *r) {
+	tl_alloc_free(in, r->names);
+	tl_alloc_free(in, r->shared);
+	tl_alloc_free(in, r->buf);
+	memset(r, 0, sizeof(*r));
+}
@@ -2,6 +2,9 @@
 #define TINYLISP_H
 
 #include <stddef.h>
+#include <stdio.h>
+/* The options the library was built with (generated by the Makefile) */
+#include "tlconfig.h"
 
 #ifndef NULL
 /** Standard NULL. Only defined if not in `stddef.h`. */
@@ -27,6 +30,24 @@
 #define TL_DEFAULT_GC_EVENTS 0
 #endif
 
+#ifndef TL_DEFAULT_TASK_QUANTUM
+/** The default number of ::tl_apply_next steps a task runs before preemption.
+ *
+ * This only matters once a task has been spawned (see ::tl_spawn); it
+ * trades switching overhead against the latency of the other tasks.
+ */
+#define TL_DEFAULT_TASK_QUANTUM 1000
+#endif
+
+#ifndef TL_RUN_CLOCK_INTERVAL
+/** The number of steps `tl_run_for` takes between reads of the clock.
+ *
+ * Reading the clock costs much more than a step, so deadlines are only
+ * checked this often, and may be overrun by up to this many steps.
+ */
+#define TL_RUN_CLOCK_INTERVAL 256
+#endif
+
 #ifndef TL_DEFAULT_OBALLOC_BATCH
 /** The object allocation batch size.
  *
@@ -42,6 +63,25 @@
 #define TL_DEFAULT_OBALLOC_BATCH 65536
 #endif
 
+#ifndef TL_OUTPUT_BUFFER_SIZE
+/** The size of the output buffer, in bytes.
+ *
+ * Output is only buffered for interpreters with a tl_interp::writebuf ; it is
+ * handed over when this fills, besides the other times `tl_flush` is called.
+ */
+#define TL_OUTPUT_BUFFER_SIZE 8192
+#endif
+
+#ifndef TL_MACRO_CACHE_MAX
+/** The most expansions a pure macro (see ::tl_new_macro_pure) remembers.
+ *
+ * Expansions are keyed by the syntax objects of their arguments; the least
+ * recently added ones are forgotten beyond this limit, which bounds memory use
+ * when a pure macro is applied to freshly-generated code.
+ */
+#define TL_MACRO_CACHE_MAX 64
+#endif
+
 #if defined(PTR_LSB_AVAILABLE)
 #define TL_FMASK ((1 << PTR_LSB_AVAILABLE) - 1)
 #if PTR_LSB_AVAILABLE < 2
@@ -183,6 +223,8 @@ typedef struct tl_object_s {
 			struct tl_object_s *state;
 			/** For ::TL_THEN and ::TL_CFUNC, a C string containing the name of the function, or NULL. */
 			char *name;
+			/** For ::TL_CFUNC_BYVAL declared with ::TL_CFBV_N, the ::tl_init_ent giving the array-convention function and its arity; otherwise NULL. */
+			const struct tl_init_ent_s *ent;
 		};
 		struct {
 			/** For ::TL_MACRO and ::TL_FUNC, the formal arguments (a linear list of symbols). */
@@ -191,7 +233,10 @@ typedef struct tl_object_s {
 			struct tl_object_s *body;
 			/** For TL_MACRO and TL_FUNC, the environment captured by the function or macro when it was defined. */
 			struct tl_object_s *env;
-			/** For TL_MACRO, the TL symbol object containing the name of the argument which will be bound to the evaluation environment, or NULL. */
+			/** For TL_MACRO, the TL symbol object containing the name of the argument which will be bound to the evaluation environment, or NULL.
+			 *
+			 * For a pure macro (see ::tl_is_macro_pure), this is instead the list of cached expansions, each `(args . expansion)`.
+			 */
 			struct tl_object_s *envn;
 		};
 		struct {
@@ -337,6 +382,15 @@ typedef struct tl_object_s {
 
 #endif
 
+/** Determine whether an object was frozen by ::tl_interp_freeze .
+ *
+ * Frozen objects are threaded through tl_object::next_alloc on the freezing
+ * interpreter's tl_interp::frozen list, and point tl_object::prev_alloc at
+ * themselves, which no live or free object otherwise does. They are always
+ * marked, so that no mark pass descends into them.
+ */
+#define tl_is_frozen(obj) ((obj)->prev_alloc == (obj))
+
 TL_EXTERN tl_object *tl_new(tl_interp *);
 TL_EXTERN tl_object *tl_new_int(tl_interp *, long);
 TL_EXTERN tl_object *tl_new_sym(tl_interp *, const char *);
@@ -350,15 +404,86 @@ TL_EXTERN tl_object *_tl_new_cfunc(tl_interp *, void (*)(tl_interp *, tl_object
 TL_EXTERN tl_object *_tl_new_cfunc_byval(tl_interp *, void (*)(tl_interp *, tl_object *, tl_object *), const char *);
 /** Create a new by-value cfunction, taking the name of the C function as the TL function's name */
 #define tl_new_cfunc_byval(in, cf) _tl_new_cfunc_byval((in), (cf), #cf)
+TL_EXTERN tl_object *tl_new_cfunc_argv(tl_interp *, const struct tl_init_ent_s *);
 TL_EXTERN tl_object *tl_new_macro(tl_interp *, tl_object *, tl_object *, tl_object *, tl_object *);
 /** Creates a new lambda (recognized as a macro without an envname) */
 #define tl_new_func(in, args, body, env) tl_new_macro((in), (args), NULL, (body), (env))
+TL_EXTERN tl_object *tl_new_macro_pure(tl_interp *, tl_object *, tl_object *, tl_object *);
 TL_EXTERN tl_object *tl_new_cont(tl_interp *, tl_object *, tl_object *, tl_object *);
+TL_EXTERN tl_object *tl_new_ec(tl_interp *);
+TL_EXTERN int tl_unwind(tl_interp *, tl_object *, tl_object *);
+TL_EXTERN tl_object *tl_spawn(tl_interp *, tl_object *);
+TL_EXTERN tl_object *tl_new_chan(tl_interp *);
+TL_EXTERN void tl_yield(tl_interp *);
 TL_EXTERN tl_object *tl_new_ptr(tl_interp *, void *, void (*)(tl_interp *, tl_object *), tl_tag);
 TL_EXTERN void tl_free(tl_interp *, tl_object *);
 TL_EXTERN void tl_destroy(tl_interp *, tl_object *);
 TL_EXTERN void tl_gc(tl_interp *);
 TL_EXTERN void tl_reclaim(tl_interp *);
+TL_EXTERN int tl_interp_freeze(tl_interp *);
+TL_EXTERN int tl_image_save(tl_interp *, const char *);
+TL_EXTERN int tl_image_load(tl_interp *, const char *);
+TL_EXTERN void tl_image_release(tl_interp *);
+
+/** An open-addressed map from pointers to nonzero sizes; see ::tl_ptrmap_slot . */
+typedef struct tl_ptrmap_s {
+	const void **keys;
+	size_t *vals;
+	size_t cap, len;
+} tl_ptrmap;
+TL_EXTERN size_t *tl_ptrmap_slot(tl_interp *, tl_ptrmap *, const void *);
+TL_EXTERN size_t tl_ptrmap_get(const tl_ptrmap *, const void *);
+TL_EXTERN void tl_ptrmap_free(tl_interp *, tl_ptrmap *);
+
+/** The version of the stream written by ::tl_form_encode , raised whenever its format changes. */
+#define TL_FORM_VERSION 2
+/** The version of the reader, raised whenever a change makes it read some text differently.
+ *
+ * With ::TL_FORM_VERSION , this decides ::tl_build_id .
+ */
+#define TL_READER_VERSION 1
+/** An encoder of forms into a portable byte stream; see ::tl_form_encode . */
+typedef struct tl_form_writer_s {
+	/** The encoded stream so far, and its length. */
+	unsigned char *data;
+	size_t len, sz;
+	/** The index (plus one) of each symbol name written so far. */
+	tl_ptrmap names;
+	size_t nnames;
+	/** If set (after initialization), pairs reachable more than once from a
+	 * form--shared or cyclic structure--are written once, then referred to.
+	 */
+	int shared;
+	/** With tl_form_writer::shared , the references to each pair of the form
+	 * being written, and the number of shared pairs written so far.
+	 */
+	tl_ptrmap seen;
+	size_t nshared;
+	/** If not NULL, where each form is written as soon as it is encoded; see ::tl_form_writer_init_file . */
+	FILE *file;
+} tl_form_writer;
+/** A decoder of the streams written by ::tl_form_encode ; see ::tl_form_decode . */
+typedef struct tl_form_reader_s {
+	const unsigned char *pos, *end;
+	tl_name **names;
+	size_t nnames, sznames;
+	/** The shared pairs of the form being decoded. */
+	tl_object **shared;
+	size_t nshared, szshared;
+	/** If not NULL, the file the stream is read from, through `buf`; see ::tl_form_reader_init_file . */
+	FILE *file;
+	unsigned char *buf;
+	size_t sz;
+} tl_form_reader;
+TL_EXTERN void tl_form_writer_init(tl_interp *, tl_form_writer *);
+TL_EXTERN void tl_form_writer_init_file(tl_interp *, tl_form_writer *, FILE *);
+TL_EXTERN int tl_form_encode(tl_interp *, tl_form_writer *, tl_object *);
+TL_EXTERN int tl_form_encode_autoload(tl_interp *, tl_form_writer *, tl_name *, tl_object *);
+TL_EXTERN void tl_form_writer_free(tl_interp *, tl_form_writer *);
+TL_EXTERN int tl_form_reader_init(tl_form_reader *, const void *, size_t);
+TL_EXTERN int tl_form_reader_init_file(tl_interp *, tl_form_reader *, FILE *);
+TL_EXTERN int tl_form_decode(tl_interp *, tl_form_reader *, tl_object **);
+TL_EXTERN void tl_form_reader_free(tl_interp *, tl_form_reader *);
 
 /** Test whether an object is a ::TL_INT. */
 #define tl_is_int(obj) ((obj) && (obj)->kind == TL_INT)
@@ -379,6 +504,14 @@ TL_EXTERN void tl_reclaim(tl_interp *);
 #define tl_is_cfunc_byval(obj) ((obj) && (obj)->kind == TL_CFUNC_BYVAL)
 /** Test whether an object is a ::TL_MACRO. */
 #define tl_is_macro(obj) ((obj) && (obj)->kind == TL_MACRO)
+/** Test whether an object is a pure ::TL_MACRO, whose expansions are cached (see ::tl_new_macro_pure).
+ *
+ * Purity isn't a flag of its own. An ordinary macro always names its
+ * environment argument, so its tl_object::envn is a symbol (`tl_new_macro`
+ * makes a ::TL_FUNC when there is no name); a pure macro keeps its list of
+ * cached expansions there instead, which is never a symbol.
+ */
+#define tl_is_macro_pure(obj) (tl_is_macro(obj) && !tl_is_sym((obj)->envn))
 /** Test whether an object is a ::TL_FUNC. */
 #define tl_is_func(obj) ((obj) && (obj)->kind == TL_FUNC)
 /** Test whether an object is a ::TL_CONT. */
@@ -392,6 +525,10 @@ TL_EXTERN void tl_reclaim(tl_interp *);
  *
  *   Currently, the list includes ::TL_CFUNC, ::TL_CFUNC_BYVAL, ::TL_THEN, ::TL_MACRO, ::TL_FUNC, and ::TL_CONT.
  */
+/** Determine whether an object is a task (see ::tl_spawn). */
+#define tl_is_task(obj) (tl_is_cfunc_byval(obj) && (obj)->cfunc == tl_cfbv_join)
+/** Determine whether an object is a channel (see ::tl_new_chan). */
+#define tl_is_chan(obj) (tl_is_cfunc_byval(obj) && (obj)->cfunc == tl_cfbv_chan)
 #define tl_is_callable(obj) (tl_is_cfunc(obj) || tl_is_cfunc_byval(obj) || tl_is_then(obj)|| tl_is_macro(obj) || tl_is_func(obj) || tl_is_cont(obj))
 
 /** Get the first of a pair (`car`).
@@ -451,8 +588,24 @@ TL_EXTERN char *tl_sym_to_cstr(tl_interp *, tl_object *);
 
 typedef struct tl_ns_s {
 	tl_name *root;
+	/** A read-only namespace consulted before this one, or NULL.
+	 *
+	 * Names found there are returned as they are, and only names it doesn't
+	 * have are added to `root`; see ::tl_interp_init_base .
+	 */
+	struct tl_ns_s *base;
 } tl_ns;
 
+/** Options for `tl_print_with`; see tl_interp::print_opts for `tl_print`'s. */
+typedef struct tl_print_opts {
+	/** Label shared (and cyclic) structure as `#n=`, referring back as `#n#`. */
+	int labels;
+	/** If nonzero, print lists nested this deep as `...`. */
+	size_t max_depth;
+	/** If nonzero, print only this many items of each list, then `...`. */
+	size_t max_length;
+} tl_print_opts;
+
 /** The interpreter structure.
  *
  * This represents the state of the TinyLISP interpreter at any given point in
@@ -610,8 +763,8 @@ struct tl_interp_s {
 	tl_object *values;
 	/** The "rescue stack".
 	 *
-	 * Each call to the `tl-rescue` builtin pushes a continuation object onto
-	 * this stack, which is popped if the callable returns normally. When the
+	 * Each call to the `tl-rescue` builtin pushes an escape continuation (see
+	 * ::tl_new_ec) onto this stack, which is popped if the callable returns normally. When the
 	 * interpreter encounters an error, while unwinding the stack, it will
 	 * prefer instead to call the continuation with the error, popping that
 	 * continuation off the stack internally. If this stack is empty (the
@@ -620,6 +773,28 @@ struct tl_interp_s {
 	 * line.)
 	 */
 	tl_object *rescue;
+	/** The currently running task, or `NULL` when no task was ever spawned.
+	 *
+	 * Once `tl-spawn` is first called (see ::tl_spawn), the computation
+	 * that was running becomes the "root" task, and `conts`, `values`, `env`
+	 * and `rescue` above belong to whichever task is current; the others keep
+	 * theirs in their task objects. This returns to `NULL` once the root task
+	 * finishes and no other task is runnable.
+	 */
+	tl_object *task;
+	/** The root task (see `task`); only valid while `task` is not `NULL`. */
+	tl_object *task_root;
+	/** The run queue: a list of runnable tasks, not including `task`. */
+	tl_object *tasks;
+	/** The last pair of `tasks`, for appending; not a GC root. */
+	tl_object *tasks_tail;
+	/** The number of steps a task runs before it is preempted.
+	 *
+	 * This is initialized to ::TL_DEFAULT_TASK_QUANTUM , and must not be 0.
+	 */
+	size_t task_quantum;
+	/** The remaining steps in the current task's quantum. */
+	size_t task_fuel;
 	/** The number of "events" before `tl_gc` is automatically called by `tl_push_apply`.
 	 *
 	 * Note that this happens regardless of memory pressure. A smarter
@@ -647,6 +822,22 @@ struct tl_interp_s {
 	int putback;
 	/** Whether or not `tl_getc` will return the last "putback". */
 	int is_putback;
+	/** Input the host has already read, which `tl_getc` (and a
+	 * `TL_APPLY_GETCHAR`) consumes before calling tl_interp::readf .
+	 *
+	 * A host holding a whole file (or any large part of its input) in memory
+	 * can point this at it; `tl_read` then parses forms straight out of it,
+	 * rather than a character at a time (see ::TL_READ_FAST_DEPTH). The
+	 * memory is borrowed, and must outlive its use; once `input_pos` reaches
+	 * `input_len`, reading goes on with tl_interp::readf, and the host may
+	 * replace the buffer (or tl_interp::readbuf replaces it). This is NULL
+	 * (and empty) by default.
+	 */
+	const char *input_buf;
+	/** The length of tl_interp::input_buf . */
+	size_t input_len;
+	/** The position of the next character to read in tl_interp::input_buf . */
+	size_t input_pos;
 	/** The buffer being built by a `tl_read` call.
 	 *
 	 * This is stored here for efficiency reasons, and little else; it can't be
@@ -661,6 +852,16 @@ struct tl_interp_s {
 	size_t read_ptr;
 	/** The allocated length of the read buffer. */
 	size_t read_sz;
+	/** Output not yet passed to tl_interp::writebuf , allocated (of
+	 * ::TL_OUTPUT_BUFFER_SIZE bytes) on first use.
+	 */
+	char *output_buf;
+	/** The length of the output in tl_interp::output_buf . */
+	size_t output_len;
+	/** If set, output is flushed at the end of every line, as for a
+	 * terminal. This is 0 by default.
+	 */
+	int flush_lines;
 	/** The character `tl-display` writes between arguments.
 	 *
 	 * This can be set at runtime with tl-display-sep. By default, it is '\t'
@@ -673,6 +874,18 @@ struct tl_interp_s {
 	 * `\0', which means no indentation is done.
 	 */
 	char disp_indent;
+	/** The options `tl_print` (and so `tl-display`) prints with.
+	 *
+	 * This can be set at runtime with tl-print-opts. By default, all are zero:
+	 * no labels or limits, so cyclic structure is printed forever.
+	 */
+	tl_print_opts print_opts;
+	/** The name a loop's frame binds to its record, for break and recur.
+	 *
+	 * This is resolved when first needed, then kept so that each iteration
+	 * doesn't look it up again; it starts as NULL.
+	 */
+	tl_name *loop_name;
 	/** An opaque "user data" pointer for use with interface functions.
 	 *
 	 * This value is stored but never modified by TinyLISP; it is not even
@@ -684,6 +897,36 @@ struct tl_interp_s {
 	 * pointers stored in the interpreter.
 	 */
 	void *udata;
+	/** Per-interpreter state of modules, as key-value pairs; see ::tl_mod_state . */
+	struct tl_mod_state_s {
+		const void *key;
+		void *value;
+	} *mod_state;
+	/** The number of entries in `mod_state`. */
+	size_t mod_state_len;
+	/** The objects frozen by ::tl_interp_freeze , or NULL.
+	 *
+	 * This list is threaded through tl_object::next_alloc like `top_alloc`,
+	 * but is never collected; it is freed by ::tl_interp_cleanup .
+	 */
+	tl_object *frozen;
+	/** The namespace of the frozen objects' symbols; `root` is NULL until frozen. */
+	tl_ns frozen_ns;
+	/** The heap image mapped by ::tl_image_load , or NULL, and its length. */
+	void *image;
+	size_t image_len;
+	/** Definitions not yet loaded, by name; see ::tl_autoload .
+	 *
+	 * Each value is an index (plus one) into tl_interp::autoloads , or 0 once
+	 * the definition has been loaded.
+	 */
+	tl_ptrmap autoload;
+	/** The encoded forms of each definition given to ::tl_autoload . */
+	struct tl_autoload_ent_s {
+		const void *data;
+		size_t len;
+	} *autoloads;
+	size_t nautoloads, szautoloads;
 	/** The next tag to return.
 	 *
 	 * This is the value next returned from ::tl_new_tag, to identify a type.
@@ -707,6 +950,20 @@ struct tl_interp_s {
 	 * this.
 	 */
 	int (*readf)(struct tl_interp_s *);
+	/** Function to read a block of input immediately.
+	 *
+	 * If this isn't NULL, it is used instead of tl_interp::readf whenever
+	 * tl_interp::input_buf runs out, and is invoked in the same places. It is
+	 * expected to point `*data` at the next chunk of input, store its length
+	 * in `*len`, and return nonzero; or to return 0 at the end of input. The
+	 * chunk is borrowed, and must stay valid until the next call; it becomes
+	 * the new tl_interp::input_buf , so `tl_read` parses straight out of it,
+	 * and characters put back with `tl_putback` are usually just unread.
+	 *
+	 * The arguments are the current interpreter, and where to store the
+	 * chunk and its length. This is NULL by default.
+	 */
+	int (*readbuf)(struct tl_interp_s *, const char **, size_t *);
 	/** Function to write a character.
 	 *
 	 * This function is called to output a byte of output from TinyLISP to
@@ -720,6 +977,25 @@ struct tl_interp_s {
 	 * implementation set by tl_interp_init() does this.
 	 */
 	void (*writef)(struct tl_interp_s *, char);
+	/** Function to write a block of output.
+	 *
+	 * If this isn't NULL, output is collected in tl_interp::output_buf and
+	 * handed to this function in bulk (see `tl_flush`), instead of calling
+	 * tl_interp::writef per character.
+	 *
+	 * The arguments are the current interpreter, the data, and its length.
+	 * This is NULL by default.
+	 */
+	void (*writebuf)(struct tl_interp_s *, const char *, size_t);
+	/** Function to read a monotonic clock, in nanoseconds.
+	 *
+	 * This is only used by `tl_run_for` to enforce its deadline, which is
+	 * compared against the values this returns; the epoch is arbitrary. If
+	 * this is NULL, deadlines are ignored. The default set by
+	 * `tl_interp_init` uses `clock_gettime` on UNIX platforms, and is NULL
+	 * elsewhere.
+	 */
+	unsigned long long (*clockf)(struct tl_interp_s *);
 	/** Function to allocate or free memory.
 	 *
 	 * The arguments are either a pointer previously returned by this function,
@@ -777,6 +1053,8 @@ struct tl_interp_s {
 
 /** Set to indicate the function is `CFUNC_BYVAL` instead of `CFUNC`. */
 #define TL_EF_BYVAL 0x01
+/** Set to indicate the function takes an argument array (see ::TL_CFBV_N). */
+#define TL_EF_ARGV 0x02
 /** Type of an initialization entry.
  *
  * At compilation time, a number of these entries are put into the same binary
@@ -796,14 +1074,22 @@ typedef struct tl_init_ent_s {
 	const char *file;
 	/** The line in which this was declared. */
 	unsigned line;
+	/** For `TL_EF_ARGV`, the C function to invoke with an argument array. */
+	void (*fnv)(tl_interp *, size_t, tl_object **);
+	/** For `TL_EF_ARGV`, the minimum number of arguments. */
+	long min;
+	/** For `TL_EF_ARGV`, the maximum number of arguments, or -1 if unbounded. */
+	long max;
 } __attribute__((aligned(8))) tl_init_ent;
 
 TL_EXTERN void tl_interp_init(tl_interp *);
 TL_EXTERN void tl_interp_init_alloc(tl_interp *, void *(*)(struct tl_interp_s *, void *, size_t));
+TL_EXTERN void tl_interp_init_base(tl_interp *, tl_interp *);
 TL_EXTERN void tl_interp_cleanup(tl_interp *);
 TL_EXTERN tl_object *tl_interp_load_funcs(tl_interp *, tl_object *, tl_init_ent *, tl_init_ent *);
 /** Allocate a new ::tl_tag for use with ::tl_is_tag and ::tl_new_ptr. */
 #define tl_new_tag(in) ((in)->next_tag++)
+TL_EXTERN void **tl_mod_state(tl_interp *, const void *);
 
 /** Set the error state of the interpreter.
  *
@@ -833,20 +1119,27 @@ TL_EXTERN tl_object *tl_interp_load_funcs(tl_interp *, tl_object *, tl_init_ent
  * by intent; if your environment is asynchronous, implement your own handling
  * of `TL_RESULT_GETCHAR`.
  */
-#define tl_getc(in) ((in)->is_putback ? ((in)->is_putback = 0, (in)->putback) : (in)->readf((in)))
+#define tl_getc(in) ((in)->is_putback ? ((in)->is_putback = 0, (in)->putback) : \
+		(in)->input_pos < (in)->input_len ? (unsigned char)(in)->input_buf[(in)->input_pos++] : \
+		(in)->readbuf ? _tl_getc_refill(in) : (in)->readf((in)))
 /** Put back a character to be read again with `tl_getc`, like `ungetc` in
  * stdio.
  *
- * TinyLISP only stores one putback character at a time.
+ * If the character is the one just before tl_interp::input_pos , that is
+ * just moved back. Otherwise, TinyLISP only stores one putback character at a
+ * time.
  */
-#define tl_putback(in, c) ((in)->is_putback = 1, (in)->putback = (c))
+#define tl_putback(in, c) (!(in)->is_putback && (in)->input_pos > 0 && \
+		(unsigned char)(in)->input_buf[(in)->input_pos - 1] == (c) ? \
+		(void)(in)->input_pos-- : (void)((in)->is_putback = 1, (in)->putback = (c)))
 /** Put a character on the output stream.
  *
- * This usually just invokes tl_interp::writef on the interpreter. The usual C
+ * This usually just invokes tl_interp::writef on the interpreter, or buffers
+ * the character for tl_interp::writebuf if there is one. The usual C
  * functions are tl_puts(), tl_print(), tl_write(), and tl_printf(), sometimes
  * also called via TinyLISP programs (e.g., `tl-display`).
  */
-#define tl_putc(in, c) ((in)->writef((in), (c)))
+#define tl_putc(in, c) ((in)->writebuf ? _tl_putc_buffered((in), (c)) : (in)->writef((in), (c)))
 
 /** Invoke the interpreter's memory allocation function.
  *
@@ -883,6 +1176,8 @@ TL_EXTERN tl_object *tl_frm_set(tl_interp *, tl_object *, tl_object *, tl_object
 TL_EXTERN tl_object *tl_env_top_pair(tl_interp *);
 #define tl_env_top_frame(in) tl_first(tl_env_top_pair((in)))
 TL_EXTERN void tl_env_merge(tl_interp *, tl_object *, tl_object *);
+TL_EXTERN void tl_autoload(tl_interp *, tl_name *, const void *, size_t);
+TL_EXTERN int _tl_autoload_push(tl_interp *, tl_object *);
 
 TL_EXTERN void tl_cf_macro(tl_interp *, tl_object *, tl_object *);
 TL_EXTERN void tl_cf_lambda(tl_interp *, tl_object *, tl_object *);
@@ -924,8 +1219,11 @@ TL_EXTERN void tl_cfbv_nand(tl_interp *, tl_object *, tl_object *);
 TL_EXTERN void tl_cfbv_load_mod(tl_interp *, tl_object *, tl_object *);
 
 TL_EXTERN tl_object *tl_print(tl_interp *, tl_object *);
+TL_EXTERN tl_object *tl_print_with(tl_interp *, tl_object *, const tl_print_opts *);
 TL_EXTERN void tl_puts(tl_interp *, const char *);
 TL_EXTERN void tl_write(tl_interp *, const char *, size_t);
+TL_EXTERN void _tl_putc_buffered(tl_interp *, char);
+TL_EXTERN void tl_flush(tl_interp *);
 TL_EXTERN void tl_printf(tl_interp *, const char *, ...);
 
 /** Push a direct value onto the value stack of the interpreter.
@@ -1024,6 +1322,40 @@ TL_EXTERN int tl_push_eval(tl_interp *, tl_object *, tl_object *);
  * This is used by `tl_getc_and_then` to get the actual input.
  */
 #define TL_APPLY_GETCHAR -6
+/** A special continuation flag that selects a branch of an intrinsic `if`.
+ *
+ * This is pushed by the evaluator when `tl-if` is applied with a condition
+ * that needs an application to evaluate. `expr` is the slice of the value
+ * stack holding the (syntactic) else and then branches, in that order.
+ */
+#define TL_APPLY_IF -7
+/** A special continuation flag that binds the top value locally, as `tl-define`.
+ *
+ * `expr` is the symbol to bind. Like `TL_APPLY_IF`, this is only pushed by
+ * the evaluator's intrinsic dispatch.
+ */
+#define TL_APPLY_DEFINE -8
+/** A special continuation flag that binds the top value globally, as `tl-set!`.
+ *
+ * `expr` is the symbol to bind.
+ */
+#define TL_APPLY_SET -9
+/** A special continuation flag that ends the extent of an escape continuation.
+ *
+ * `expr` is the escape continuation's state (see ::tl_new_ec), which is
+ * invalidated when this is reached--that is, when the computation it could
+ * escape from returns normally. The value stack is left as is.
+ */
+#define TL_APPLY_EXIT_EC -10
+/** A special continuation flag that delimits a continuation (a "prompt").
+ *
+ * This is pushed by `tl-reset`; `tl-shift` captures the continuation only up
+ * to the nearest one. `expr` is `(values . rescue)`, the value and rescue
+ * stacks as they were when the prompt was pushed, which likewise delimit what
+ * is captured of them. When reached, this does nothing--the value of the
+ * delimited computation passes through.
+ */
+#define TL_APPLY_PROMPT -11
 /** An application result that indicates that the program is done evaluating.
  *
  * `tl_apply_next` returns this when nothing is left to do. Note that it is the
@@ -1064,11 +1396,33 @@ TL_EXTERN void _tl_eval_all_args(tl_interp *, tl_object *, tl_object *, void (*)
 #define tl_eval_all_args(in, args, state, cb) _tl_eval_all_args((in), (args), (state), (cb), "tl_eval_all_args:" #cb)
 
 TL_EXTERN void tl_cfbv_evalin(tl_interp *, tl_object *, tl_object *);
+TL_EXTERN void tl_cfbv_join(tl_interp *, tl_object *, tl_object *);
+TL_EXTERN void tl_cfbv_chan(tl_interp *, tl_object *, tl_object *);
 TL_EXTERN void tl_cfbv_call_with_current_continuation(tl_interp *, tl_object *, tl_object *);
 /* tl_object *tl_cf_apply(tl_interp *, tl_object *); */
 void tl_run_until_done(tl_interp *);
+TL_EXTERN int tl_run_for(tl_interp *, size_t, unsigned long long, size_t *);
+
+#ifdef CONFIG_POOL
+/** A pool of interpreters on worker threads; see ::tl_pool_create . */
+typedef struct tl_pool_s tl_pool;
+/** The callback run on a worker when a job submitted by ::tl_pool_submit finishes.
+ *
+ * The arguments are the worker's interpreter, the job's result (or error),
+ * and the user argument given to ::tl_pool_submit .
+ */
+typedef void (*tl_pool_cb)(tl_interp *, tl_object *, void *);
+TL_EXTERN tl_pool *tl_pool_create(size_t, const char *);
+TL_EXTERN int tl_pool_submit(tl_pool *, const char *, tl_pool_cb, void *);
+TL_EXTERN void tl_pool_wait(tl_pool *);
+TL_EXTERN void tl_pool_destroy(tl_pool *);
+TL_EXTERN tl_object *tl_read_parallel(tl_interp *, const char *, size_t, size_t, size_t *);
+#endif
 
 TL_EXTERN void tl_read(tl_interp *);
+TL_EXTERN size_t tl_read_split(tl_interp *, const char *, size_t, size_t, size_t *, size_t *);
+TL_EXTERN int _tl_getc_refill(tl_interp *);
+TL_EXTERN const char *tl_build_id(void);
 /** Reads an expression, then invokes the continuation with it as its only argument. */
 #define tl_read_and_then(in, cb, st) do { \
 	tl_push_apply((in), 1, tl_new_then((in), (cb), (st), "tl_read_and_then:" #cb), (in)->env); \
@@ -1162,6 +1516,26 @@ void tl_cf_##func(tl_interp *in, tl_object *args, tl_object *_)
  * avoided, including for nilary functions (with no expected arguments).
  */
 #define TL_CFBV(func, nm) TL_CF_FLAGS(func, nm, TL_EF_BYVAL)
+/** Declare a CFUNC_BYVAL taking an argument array.
+ *
+ * Like `TL_CFBV`, but the function receives its (direct) arguments as a C
+ * array rather than a TL list, and is declared as:
+ *
+ *		`void tl_cf_`*nm*`(tl_interp *in, size_t argc, tl_object **argv)`
+ *
+ * The evaluator checks that `argc` is at least `min` and, unless `max` is -1,
+ * at most `max` before the call, raising an error otherwise; the function
+ * need not repeat the check. `argv` is only valid for the duration of the
+ * call. When all arguments can be resolved without an application, calling
+ * such a function allocates no argument list at all, so this should be
+ * preferred for small, frequently-called builtins.
+ */
+#define TL_CFBV_N(func, nm, mn, mx) void tl_cf_##func(tl_interp *, size_t, tl_object **);\
+static tl_init_ent __attribute__((section(TL_STRINGIFY(TL_INIT_ENTS_SECTION_NAME)),aligned(8),used)) init_tl_cf_##func = {\
+	.fnv = tl_cf_##func, .name = TL_PREFIX nm, .flags = TL_EF_BYVAL | TL_EF_ARGV,\
+	.file = __FILE__, .line = __LINE__, .min = (mn), .max = (mx),\
+};\
+void tl_cf_##func(tl_interp *in, size_t argc, tl_object **argv)
 
 #ifndef MODULE_BUILTIN
 #define TL_LOAD_FUNCS do { \
@@ -1194,6 +1568,8 @@ typedef struct tl_child_s {
 
 struct tl_name_s {
 	tl_buffer here;
+	/** Whether the printer has to quote this name; see _tl_print_needs_quotes . */
+	int quoted;
 	size_t num_children;
 	size_t sz_children;
 	tl_child *children;
@@ -1203,8 +1579,10 @@ struct tl_name_s {
 void tl_ns_init(tl_interp *, tl_ns *);
 void tl_ns_free(tl_interp *, tl_ns *);
 tl_name *tl_ns_resolve(tl_interp *, tl_ns *, tl_buffer);
+tl_name *tl_ns_find(tl_ns *, tl_buffer);
 void tl_ns_print(tl_interp *, tl_ns *);
 void tl_ns_for_each(tl_interp *, tl_ns *, void (*)(tl_interp *, tl_ns *, tl_name *, void *), void *);
 tl_buffer tl_buf_slice(tl_interp *, tl_buffer, size_t, size_t);
+int _tl_print_needs_quotes(tl_buffer);
 
 #endif
@@ -0,0 +1,2 @@
+/* Generated by the Makefile; see POOL in `make help`. */
+#define CONFIG_POOL
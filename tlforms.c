@@ -0,0 +1,139 @@
+/* Pre-parses scripts into a stream of encoded forms (see serial.c), as
+ * embedded by the Makefile for INITSCRIPTS. This runs on the build host.
+ *
+ * The reader's behavior depends on what the scripts have already done (for
+ * example, the prefixes std.tl installs with tl-prefix), so every form is also
+ * evaluated, in order, as tl would. Errors are ignored (tl would report them
+ * and go on), and output is discarded.
+ *
+ * With -a, top-level definitions of functions and macros (as in
+ * `(define name (lambda ...))`) of names not yet bound are written to be
+ * autoloaded (see tl_autoload) on their first use, instead of evaluated at
+ * startup.
+ *
+ * Usage: tlforms [-a] OUTPUT SCRIPT...
+ */
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include "tinylisp.h"
+
+struct tlforms_state {
+	char **scripts;
+	FILE *input;
+	tl_form_writer w;
+	int autoload, done, bad;
+};
+
+#define tlforms_state(in) ((struct tlforms_state *)(in)->udata)
+
+static int _tlforms_readf(tl_interp *in) {
+	struct tlforms_state *st = tlforms_state(in);
+	int c;
+	while(st->input) {
+		if((c = fgetc(st->input)) != EOF) return c;
+		fclose(st->input);
+		st->input = NULL;
+		if(*st->scripts && !(st->input = fopen(*st->scripts, "r"))) {
+			fprintf(stderr, "%s: %s\n", *st->scripts, strerror(errno));
+			st->bad = 1;
+		}
+		if(*st->scripts) st->scripts++;
+	}
+	return EOF;
+}
+
+static void _tlforms_writef(tl_interp *in, char c) {}
+
+static void _tlforms_eval_k(tl_interp *in, tl_object *result, tl_object *_) {
+	tl_cfunc_return(in, in->true_);
+}
+
+/* Whether the top-level value of sym is the builtin with the given name. */
+static int _tlforms_is_builtin(tl_interp *in, tl_object *sym, const char *name) {
+	tl_object *kv, *builtin;
+	if(!tl_is_sym(sym) || !(kv = tl_env_get_kv(in, in->top_env, sym))) return 0;
+	builtin = tl_env_get_kv(in, in->top_env, tl_new_sym(in, name));
+	return builtin && tl_next(kv) == tl_next(builtin);
+}
+
+/* Whether a form only defines a new function or macro, returning its name. */
+static tl_object *_tlforms_definition(tl_interp *in, tl_object *form) {
+	tl_object *name = tl_first(tl_next(form)), *val = tl_first(tl_next(tl_next(form)));
+	if(tl_list_len(form) != 3 || !_tlforms_is_builtin(in, tl_first(form), "tl-define")) return NULL;
+	if(!tl_is_sym(name) || tl_env_get_kv(in, in->top_env, name)) return NULL;
+	if(!val || !tl_is_pair(val)) return NULL;
+	if(!_tlforms_is_builtin(in, tl_first(val), "tl-lambda") && !_tlforms_is_builtin(in, tl_first(val), "tl-macro") && !_tlforms_is_builtin(in, tl_first(val), "tl-macro-pure")) return NULL;
+	return name;
+}
+
+static void _tlforms_read_k(tl_interp *in, tl_object *args, tl_object *_) {
+	struct tlforms_state *st = tlforms_state(in);
+	tl_object *expr = tl_first(args), *name;
+	int ok;
+	if(!expr) {
+		st->done = 1;
+		tl_cfunc_return(in, in->true_);
+	}
+	if(st->autoload && (name = _tlforms_definition(in, expr))) {
+		ok = tl_form_encode_autoload(in, &st->w, name->nm, expr);
+	} else {
+		ok = tl_form_encode(in, &st->w, expr);
+	}
+	if(!ok) {
+		fprintf(stderr, "tlforms: can't encode a form\n");
+		st->bad = 1;
+	}
+	tl_eval_and_then(in, expr, NULL, _tlforms_eval_k);
+}
+
+int main(int argc, char **argv) {
+	tl_interp real_in, *in = &real_in;
+	struct tlforms_state st = { 0 };
+	FILE *out;
+
+	if(argc > 1 && !strcmp(argv[1], "-a")) {
+		st.autoload = 1;
+		argv++;
+		argc--;
+	}
+	if(argc < 3) {
+		fprintf(stderr, "usage: %s [-a] OUTPUT SCRIPT...\n", argv[0]);
+		return 1;
+	}
+	st.scripts = argv + 2;
+	if(!(st.input = fopen(*st.scripts, "r"))) {
+		fprintf(stderr, "%s: %s\n", *st.scripts, strerror(errno));
+		return 1;
+	}
+	st.scripts++;
+
+	tl_interp_init(in);
+	in->udata = &st;
+	in->readf = _tlforms_readf;
+	in->writef = _tlforms_writef;
+	tl_form_writer_init(in, &st.w);
+
+	while(!st.done && !st.bad) {
+		tl_read_and_then(in, _tlforms_read_k, TL_EMPTY_LIST);
+		tl_run_until_done(in);
+		tl_error_clear(in);
+		tl_interp_reset(in);
+		tl_gc(in);
+	}
+
+	if(!st.bad) {
+		if(!(out = fopen(argv[1], "wb"))) {
+			fprintf(stderr, "%s: %s\n", argv[1], strerror(errno));
+			st.bad = 1;
+		} else {
+			if(fwrite(st.w.data, 1, st.w.len, out) != st.w.len) st.bad = 1;
+			if(fclose(out)) st.bad = 1;
+			if(st.bad) fprintf(stderr, "%s: write failed\n", argv[1]);
+		}
+	}
+	tl_form_writer_free(in, &st.w);
+	tl_interp_cleanup(in);
+	return st.bad;
+}
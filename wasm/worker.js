@@ -2,7 +2,9 @@ var output = null;
 var stdin = "", stdout = "", yielded = false;
 var mod, inst;
 var loop = null;
-var MoreData = {};
+var MoreData = {}, OutOfBudget = {};
+// The most tl_apply_next steps run before returning to the event loop
+var STEP_BUDGET = 100000;
 
 function crankNL() {
 	if(stdin.indexOf("\n") != -1) crank();
@@ -30,6 +32,12 @@ function crank(once) {
 				yielded = true;
 				continue;
 			}
+			if(res.value === OutOfBudget) {
+				// Let messages through before running the next slice
+				flush();
+				setTimeout(crank, 0, true);
+				return;
+			}
 			throw new Error("Not sure how to handle suspension of value " + res.value);
 		}
 	} catch(e) {
@@ -154,10 +162,12 @@ function* mainloop() {
 		inst.exports.tl_push_apply(interp, 1, main_then, inst.exports.tl_wasm_get_env(interp));
 		inst.exports.tl_read(interp);
 		while(true) {
-			var res = inst.exports.tl_apply_next(interp)
+			var res = inst.exports.tl_run_for(interp, STEP_BUDGET, 0, 0);
 			if(res == 0) break;
 			switch(res) {
-				case 1: break;
+				case 1:
+					yield OutOfBudget;
+					break;
 				case 2:
 					yield MoreData;
 					break;